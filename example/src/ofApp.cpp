@@ -34,20 +34,28 @@ void ofApp::setup()
                           this,
                           &ofApp::getText);
 
+    // These methods modify state that is drawn by the app, so they are
+    // invoked on the main thread during update and need no locking.
     server.registerMethod("set-text",
                           "Sets text from the user.",
                           this,
-                          &ofApp::setText);
+                          &ofApp::setText,
+                          OF_EVENT_ORDER_AFTER_APP,
+                          ofx::JSONRPC::MethodDispatch::MAIN_THREAD);
 
     server.registerMethod("ping",
                           "Send a JSONRPC Ping Notification",
                           this,
-                          &ofApp::ping);
+                          &ofApp::ping,
+                          OF_EVENT_ORDER_AFTER_APP,
+                          ofx::JSONRPC::MethodDispatch::MAIN_THREAD);
 
     server.registerMethod("pong",
                           "Send a JSONRPC Pong Notification",
                           this,
-                          &ofApp::pong);
+                          &ofApp::pong,
+                          OF_EVENT_ORDER_AFTER_APP,
+                          ofx::JSONRPC::MethodDispatch::MAIN_THREAD);
 
     // Start the server.
     server.start();
@@ -108,8 +116,8 @@ void ofApp::getText(ofx::JSONRPC::MethodArgs& args)
 
 void ofApp::setText(ofx::JSONRPC::MethodArgs& args)
 {
-    // Set the user text.
-    setUserText(args.params);
+    // Set the user text. This is called on the main thread.
+    userText = args.params;
     ofLogVerbose("ofApp::setText") << args.params.dump(4);
 }
 
@@ -118,7 +126,8 @@ std::string ofApp::getRandomText() const
 {
     static const std::size_t LENGTH = 140;
 
-    std::unique_lock<std::mutex> lock(mutex);
+    // The ipsum is not modified after setup, so it can be read from any
+    // thread.
 
     // Generate a random start index.
     std::size_t startIndex = (std::size_t)ofRandom(ipsum.length());
@@ -130,17 +139,3 @@ std::string ofApp::getRandomText() const
     return ipsum.substr(startIndex, length);
 }
 
-
-std::string ofApp::getUserText() const
-{
-    std::unique_lock<std::mutex> lock(mutex);
-    return userText;
-}
-
-
-void ofApp::setUserText(const std::string& text)
-{
-    std::unique_lock<std::mutex> lock(mutex);
-    userText = text;
-}
-
@@ -29,7 +29,6 @@ public:
     // Register a no-argument notification method.
     void pong();
 
-    /// \todo is ofSoundPlayer thread-safe?
     ofSoundPlayer pingPlayer;
     ofSoundPlayer pongPlayer;
 
@@ -40,31 +39,18 @@ public:
     /// \returns The snippet of random text.
     std::string getRandomText() const;
 
-    /// \brief Get the user text in a thread-safe way.
-    /// \returns The user text.
-    std::string getUserText() const;
-
-    /// \brief Set the user text in a thread-safe way.
-    /// \param text the user text to set.
-    void setUserText(const std::string& text);
-
 private:
     // A custom logging channel to mirror all log messages to the web clients.
     // WebSocketLoggerChannel::SharedPtr loggerChannel;
 
-    // This piece of text might be modified by multiple client threads.
-    // Thus we must use a mutex to protect it during multi-threaded access.
+    // This piece of text is only read after setup, so it can be shared by
+    // multiple client threads without a mutex.
     std::string ipsum;
 
-    // This piece of text might be modified by multiple client threads.
-    // Thus we must use a mutex to protect it during multi-threaded access.
+    // This piece of text is only modified by set-text, which is invoked on
+    // the main thread, so it can be drawn without a mutex.
     std::string userText;
 
-    // We use a mutex to protect any variables that can be
-    // modified by multiple clients. In our case, userText must be protected.
-    // We mark the mutex as mutable so that it can be used in const functions.
-    mutable std::mutex mutex;
-    
     float fader = 0;
     std::string fadingText;
 
@@ -0,0 +1,367 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofApp.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <thread>
+
+
+std::string BenchmarkServer::processBuffer(ofx::HTTP::ServerEventArgs& evt,
+                                           const ofBuffer& message,
+                                           ofx::JSONRPC::Encoding encoding)
+{
+    ofJson json = ofx::JSONRPC::JSONRPCUtils::parse(message, encoding);
+
+    // Wait for the response, as onHTTPPostEvent does.
+    std::promise<std::string> promise;
+    std::future<std::string> future = promise.get_future();
+
+    processMessage(this, evt, std::move(json), encoding, [&promise](std::string& buffer) {
+        promise.set_value(std::move(buffer));
+    });
+
+    return future.get();
+}
+
+
+const std::vector<std::size_t> ofApp::PAYLOAD_SIZES = { 16, 1024, 65536, 1048576 };
+const std::vector<std::size_t> ofApp::THREAD_COUNTS = { 1, 2, 4, 8 };
+const std::vector<std::size_t> ofApp::METHOD_COUNTS = { 1, 100, 10000 };
+const std::vector<ofx::JSONRPC::Encoding> ofApp::ENCODINGS = {
+    ofx::JSONRPC::Encoding::JSON,
+    ofx::JSONRPC::Encoding::CBOR,
+    ofx::JSONRPC::Encoding::MESSAGE_PACK
+};
+
+
+static std::string toString(ofx::JSONRPC::Encoding encoding)
+{
+    switch (encoding)
+    {
+        case ofx::JSONRPC::Encoding::JSON:
+            return "json";
+        case ofx::JSONRPC::Encoding::CBOR:
+            return "cbor";
+        case ofx::JSONRPC::Encoding::MESSAGE_PACK:
+            return "msgpack";
+    }
+
+    return "unknown";
+}
+
+
+void ofApp::setup()
+{
+    // Only the results are written to stdout, so that they can be piped to
+    // another tool. The console logger writes messages below errors to
+    // stdout, so progress is written to stderr instead.
+    ofSetLogLevel(OF_LOG_ERROR);
+
+    benchmarkParse();
+    benchmarkRequestFromJSON();
+    benchmarkProcessCall();
+    benchmarkResponseWrite();
+    benchmarkMessage();
+
+    ofJson json;
+    json["duration"] = duration.count() / 1000.0;
+    json["hardwareConcurrency"] = std::thread::hardware_concurrency();
+    json["results"] = results;
+
+    // Print the results so they can be piped to another tool, and save
+    // them so they can be compared with a later run.
+    std::cout << json.dump(4) << std::endl;
+
+    ofSavePrettyJson("benchmark.json", json);
+
+    ofExit();
+}
+
+
+void ofApp::exit()
+{
+    // Set the logger back to the default to make sure any
+    // remaining messages are logged correctly.
+    ofLogToConsole();
+}
+
+
+void ofApp::echo(ofx::JSONRPC::MethodArgs& args)
+{
+    args.result = args.params;
+}
+
+
+void ofApp::benchmarkParse()
+{
+    for (auto size: PAYLOAD_SIZES)
+    {
+        ofJson json;
+        json["jsonrpc"] = "2.0";
+        json["id"] = 1;
+        json["method"] = "echo";
+        json["params"] = makePayload(size);
+
+        std::string text = json.dump();
+
+        ofBuffer buffer(text.data(), text.size());
+
+        measure("ofJson::parse(ofBuffer::getText)", { { "payloadSize", size } }, 1, [&](std::size_t) {
+            ofJson parsed = ofJson::parse(buffer.getText());
+        });
+
+        measure("JSONRPCUtils::parse(ofBuffer)", { { "payloadSize", size } }, 1, [&](std::size_t) {
+            ofJson parsed = ofx::JSONRPC::JSONRPCUtils::parse(buffer);
+        });
+    }
+}
+
+
+void ofApp::benchmarkRequestFromJSON()
+{
+    for (auto size: PAYLOAD_SIZES)
+    {
+        ofJson json;
+        json["jsonrpc"] = "2.0";
+        json["id"] = 1;
+        json["method"] = "echo";
+        json["params"] = makePayload(size);
+
+        ofx::JSONRPC::DetachedServerEvent event;
+
+        measure("Request::fromJSON", { { "payloadSize", size } }, 1, [&](std::size_t) {
+            ofx::JSONRPC::Request request = ofx::JSONRPC::Request::fromJSON(event.args(), json);
+        });
+    }
+}
+
+
+void ofApp::benchmarkProcessCall()
+{
+    for (auto numMethods: METHOD_COUNTS)
+    {
+        ofx::JSONRPC::MethodRegistry registry;
+
+        std::vector<std::string> methods;
+
+        for (std::size_t i = 0; i < numMethods; ++i)
+        {
+            methods.push_back("echo-" + std::to_string(i));
+            registry.registerMethod(methods.back(), "Returns the parameters.", this, &ofApp::echo);
+        }
+
+        ofJson params = makePayload(16);
+
+        for (bool isStatsEnabled: { false, true })
+        {
+            registry.setStatsEnabled(isStatsEnabled);
+
+            for (auto numThreads: THREAD_COUNTS)
+            {
+                std::vector<ofx::JSONRPC::DetachedServerEvent> events(numThreads);
+                std::vector<std::size_t> methodIndices(numThreads, 0);
+
+                ofJson parameters;
+                parameters["methods"] = numMethods;
+                parameters["stats"] = isStatsEnabled;
+
+                // Each thread calls the methods in turn, so that larger
+                // method tables are not measured with a single hot entry.
+                measure("MethodRegistry::processCall", parameters, numThreads, [&](std::size_t thread) {
+                    std::size_t& methodIndex = methodIndices[thread];
+                    ofx::JSONRPC::Request request(events[thread].args(), 1, methods[methodIndex], params);
+                    ofx::JSONRPC::Response response = registry.processCall(this, request);
+                    methodIndex = (methodIndex + 1) % numMethods;
+                });
+            }
+        }
+    }
+}
+
+
+void ofApp::benchmarkResponseWrite()
+{
+    ofx::JSONRPC::DetachedServerEvent event;
+
+    for (auto size: PAYLOAD_SIZES)
+    {
+        ofx::JSONRPC::Response response(event.args(), 1, makePayload(size));
+
+        measure("Response::toString", { { "payloadSize", size } }, 1, [&](std::size_t) {
+            std::string buffer = response.toString();
+        });
+
+        for (auto encoding: ENCODINGS)
+        {
+            ofJson parameters;
+            parameters["payloadSize"] = size;
+            parameters["encoding"] = toString(encoding);
+
+            measure("Response::write", parameters, 1, [&](std::size_t) {
+                std::string buffer;
+                response.write(buffer, encoding);
+            });
+        }
+    }
+}
+
+
+void ofApp::benchmarkMessage()
+{
+    BenchmarkServer server;
+
+    server.registerMethod("echo", "Returns the parameters.", this, &ofApp::echo);
+
+    for (auto size: PAYLOAD_SIZES)
+    {
+        ofJson json;
+        json["jsonrpc"] = "2.0";
+        json["id"] = 1;
+        json["method"] = "echo";
+        json["params"] = makePayload(size);
+
+        for (auto encoding: ENCODINGS)
+        {
+            std::string encoded;
+            ofx::JSONRPC::JSONRPCUtils::write(json, encoding, encoded);
+
+            ofBuffer message(encoded.data(), encoded.size());
+
+            for (auto numThreads: THREAD_COUNTS)
+            {
+                std::vector<ofx::JSONRPC::DetachedServerEvent> events(numThreads);
+
+                ofJson parameters;
+                parameters["payloadSize"] = size;
+                parameters["encoding"] = toString(encoding);
+
+                measure("JSONRPCServer::processMessage", parameters, numThreads, [&](std::size_t thread) {
+                    std::string response = server.processBuffer(events[thread].args(), message, encoding);
+                });
+            }
+        }
+    }
+}
+
+
+void ofApp::measure(const std::string& name,
+                    const ofJson& parameters,
+                    std::size_t numThreads,
+                    std::function<void(std::size_t)> operation)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::atomic<std::size_t> numReadyThreads(0);
+    std::atomic<bool> isStarted(false);
+    std::atomic<bool> isStopped(false);
+
+    std::vector<uint64_t> numOperations(numThreads, 0);
+    std::vector<Clock::duration> elapsedTimes(numThreads, Clock::duration::zero());
+
+    std::vector<std::thread> threads;
+
+    for (std::size_t thread = 0; thread < numThreads; ++thread)
+    {
+        threads.emplace_back([&, thread]() {
+            for (std::size_t i = 0; i < numWarmUpOperations; ++i)
+            {
+                operation(thread);
+            }
+
+            ++numReadyThreads;
+
+            while (!isStarted)
+            {
+                std::this_thread::yield();
+            }
+
+            Clock::time_point startTime = Clock::now();
+
+            uint64_t count = 0;
+
+            // Slow operations are measured at least once.
+            do
+            {
+                operation(thread);
+                ++count;
+            }
+            while (!isStopped);
+
+            elapsedTimes[thread] = Clock::now() - startTime;
+            numOperations[thread] = count;
+        });
+    }
+
+    // Start measuring once every thread has warmed up.
+    while (numReadyThreads < numThreads)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    isStarted = true;
+    std::this_thread::sleep_for(duration);
+    isStopped = true;
+
+    for (auto& thread: threads)
+    {
+        thread.join();
+    }
+
+    uint64_t totalOperations = 0;
+    double operationsPerSecond = 0;
+    double nanosecondsPerOperation = 0;
+
+    for (std::size_t thread = 0; thread < numThreads; ++thread)
+    {
+        double seconds = std::chrono::duration<double>(elapsedTimes[thread]).count();
+
+        totalOperations += numOperations[thread];
+
+        if (seconds > 0)
+        {
+            operationsPerSecond += numOperations[thread] / seconds;
+            nanosecondsPerOperation += seconds * 1e9 / numOperations[thread] / numThreads;
+        }
+    }
+
+    ofJson result;
+    result["benchmark"] = name;
+    result["parameters"] = parameters;
+    result["threads"] = numThreads;
+    result["operations"] = totalOperations;
+    result["operationsPerSecond"] = operationsPerSecond;
+    result["nanosecondsPerOperation"] = nanosecondsPerOperation;
+
+    std::cerr << name << " " << parameters.dump() << " threads=" << numThreads << ": " << nanosecondsPerOperation << " ns/op" << std::endl;
+
+    results.push_back(result);
+}
+
+
+ofJson ofApp::makePayload(std::size_t size)
+{
+    ofJson payload = ofJson::array();
+
+    std::size_t payloadSize = 2;
+
+    while (payloadSize < size)
+    {
+        std::size_t i = payload.size();
+
+        ofJson item;
+        item["id"] = i;
+        item["name"] = "item-" + std::to_string(i);
+        item["value"] = i * 0.5;
+
+        payloadSize += item.dump().size() + 1;
+        payload.push_back(item);
+    }
+
+    return payload;
+}
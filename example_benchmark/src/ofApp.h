@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <chrono>
+#include <functional>
+#include "ofMain.h"
+#include "ofxJSONRPC.h"
+
+
+/// \brief A JSONRPCServer that processes messages without a connection.
+class BenchmarkServer: public ofx::HTTP::JSONRPCServer
+{
+public:
+    /// \brief Parse, process and serialize one message, like a WebSocket
+    ///        frame or an HTTP POST body.
+    /// \param evt The originating server event.
+    /// \param message The encoded message.
+    /// \param encoding The encoding of the message and its response.
+    /// \returns the encoded response, or an empty string if the message
+    ///          contained only notifications.
+    std::string processBuffer(ofx::HTTP::ServerEventArgs& evt,
+                              const ofBuffer& message,
+                              ofx::JSONRPC::Encoding encoding);
+
+};
+
+
+class ofApp: public ofBaseApp
+{
+public:
+    void setup() override;
+    void exit() override;
+
+    // Registered methods.
+    void echo(ofx::JSONRPC::MethodArgs& args);
+
+    /// \brief Measure parsing a received buffer with and without copying
+    ///        it into a string first, across payload sizes.
+    void benchmarkParse();
+
+    /// \brief Measure Request::fromJSON across payload sizes.
+    void benchmarkRequestFromJSON();
+
+    /// \brief Measure MethodRegistry::processCall across method counts,
+    ///        thread counts and with and without statistics.
+    void benchmarkProcessCall();
+
+    /// \brief Measure Response::toString and Response::write across payload
+    ///        sizes and encodings.
+    void benchmarkResponseWrite();
+
+    /// \brief Measure the path from a received message to its encoded
+    ///        response across payload sizes, encodings and thread counts.
+    void benchmarkMessage();
+
+    /// \brief Call an operation repeatedly on several threads.
+    ///
+    /// Each thread calls the operation a few times to warm up, then at least
+    /// once more until the benchmark duration has passed. The result is
+    /// added to the results and logged.
+    ///
+    /// \param name The name of the benchmark.
+    /// \param parameters The parameters of this case.
+    /// \param numThreads The number of threads calling the operation.
+    /// \param operation The operation, called with the index of the calling
+    ///        thread.
+    void measure(const std::string& name,
+                 const ofJson& parameters,
+                 std::size_t numThreads,
+                 std::function<void(std::size_t)> operation);
+
+    /// \brief Create a JSON payload.
+    /// \param size The minimum size of the payload serialized as JSON text.
+    /// \returns an array of objects with numbers and strings.
+    static ofJson makePayload(std::size_t size);
+
+    /// \brief The payload sizes to measure in bytes.
+    static const std::vector<std::size_t> PAYLOAD_SIZES;
+
+    /// \brief The thread counts to measure.
+    static const std::vector<std::size_t> THREAD_COUNTS;
+
+    /// \brief The numbers of registered methods to measure.
+    static const std::vector<std::size_t> METHOD_COUNTS;
+
+    /// \brief The encodings to measure.
+    static const std::vector<ofx::JSONRPC::Encoding> ENCODINGS;
+
+    /// \brief How long each case is measured.
+    std::chrono::milliseconds duration = std::chrono::milliseconds(250);
+
+    /// \brief The number of calls made on each thread before measuring.
+    std::size_t numWarmUpOperations = 10;
+
+    /// \brief The results of all cases.
+    ofJson results = ofJson::array();
+
+};
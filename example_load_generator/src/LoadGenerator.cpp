@@ -0,0 +1,583 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "LoadGenerator.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "Poco/Buffer.h"
+#include "Poco/Exception.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/WebSocket.h"
+#include "ofLog.h"
+#include "ofUtils.h"
+
+
+/// \brief Parse a non-negative integer argument.
+/// \param name The name of the argument.
+/// \param value The value of the argument.
+/// \returns the integer.
+/// \throws std::invalid_argument if the value is not a non-negative integer.
+static std::size_t toSize(const std::string& name, const std::string& value)
+{
+    if (value.empty() || !std::all_of(value.begin(), value.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+    {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value);
+    }
+
+    return std::size_t(std::stoull(value));
+}
+
+
+LoadGeneratorSettings LoadGeneratorSettings::fromArguments(const std::vector<std::string>& arguments)
+{
+    LoadGeneratorSettings settings;
+
+    for (const auto& argument: arguments)
+    {
+        std::size_t equals = argument.find('=');
+        std::string name = argument.substr(0, equals);
+        std::string value = equals != std::string::npos ? argument.substr(equals + 1) : "";
+
+        if (name == "--host")
+        {
+            settings.host = value;
+        }
+        else if (name == "--port")
+        {
+            std::size_t port = toSize(name, value);
+
+            if (port == 0 || port > 65535)
+            {
+                throw std::invalid_argument("Invalid value for " + name + ": " + value);
+            }
+
+            settings.port = uint16_t(port);
+        }
+        else if (name == "--websocket-path")
+        {
+            settings.webSocketPath = value;
+        }
+        else if (name == "--post-path")
+        {
+            settings.postPath = value;
+        }
+        else if (name == "--transport")
+        {
+            if (value == "websocket")
+            {
+                settings.transport = Transport::WEBSOCKET;
+            }
+            else if (value == "post")
+            {
+                settings.transport = Transport::POST;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid value for " + name + ": " + value);
+            }
+        }
+        else if (name == "--connections")
+        {
+            settings.numConnections = toSize(name, value);
+        }
+        else if (name == "--pipeline")
+        {
+            settings.pipelineDepth = toSize(name, value);
+        }
+        else if (name == "--batch")
+        {
+            settings.batchSize = toSize(name, value);
+        }
+        else if (name == "--payload")
+        {
+            settings.payloadSize = toSize(name, value);
+        }
+        else if (name == "--mix")
+        {
+            settings.methodMix.clear();
+
+            for (const auto& entry: ofSplitString(value, ",", true, true))
+            {
+                std::vector<std::string> parts = ofSplitString(entry, ":", false, true);
+
+                MethodMixEntry methodMixEntry;
+                methodMixEntry.method = parts[0];
+
+                if (parts.size() > 1)
+                {
+                    std::size_t weight = toSize(name, parts[1]);
+                    methodMixEntry.weight = double(weight);
+                }
+
+                if (parts.size() > 2 || methodMixEntry.method.empty() || methodMixEntry.weight <= 0)
+                {
+                    throw std::invalid_argument("Invalid value for " + name + ": " + value);
+                }
+
+                settings.methodMix.push_back(methodMixEntry);
+            }
+        }
+        else if (name == "--duration")
+        {
+            settings.duration = std::chrono::milliseconds(toSize(name, value) * 1000);
+        }
+        else if (name == "--call-timeout")
+        {
+            settings.callTimeout = std::chrono::milliseconds(toSize(name, value));
+        }
+        else if (name == "--workers")
+        {
+            settings.numWorkerThreads = toSize(name, value);
+        }
+        else if (name == "--sleep-time")
+        {
+            settings.sleepTime = std::chrono::milliseconds(toSize(name, value));
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown argument: " + argument);
+        }
+    }
+
+    if (settings.numConnections == 0 || settings.pipelineDepth == 0 || settings.batchSize == 0)
+    {
+        throw std::invalid_argument("The connections, pipeline and batch sizes must be at least 1.");
+    }
+
+    if (settings.callTimeout.count() == 0)
+    {
+        throw std::invalid_argument("The call timeout must be at least 1 millisecond.");
+    }
+
+    if (settings.methodMix.empty())
+    {
+        throw std::invalid_argument("The method mix must contain at least one method.");
+    }
+
+    return settings;
+}
+
+
+std::string LoadGeneratorSettings::usage()
+{
+    std::stringstream ss;
+    ss << "Options:" << std::endl;
+    ss << "  --transport=websocket|post  The route to send calls to. (websocket)" << std::endl;
+    ss << "  --connections=N             The number of connections. (8)" << std::endl;
+    ss << "  --pipeline=N                The requests in flight per connection. (1)" << std::endl;
+    ss << "  --batch=N                   The calls per request. (1)" << std::endl;
+    ss << "  --payload=BYTES             The size of the parameters of each call. (16)" << std::endl;
+    ss << "  --mix=METHOD[:WEIGHT],...   The methods to call, e.g. echo:9,sleep:1. (echo)" << std::endl;
+    ss << "  --duration=SECONDS          How long to send calls. (10)" << std::endl;
+    ss << "  --call-timeout=MILLISECONDS How long to wait for a response. (5000)" << std::endl;
+    ss << "  --workers=N                 The server's worker threads, 0 for one per core. (0)" << std::endl;
+    ss << "  --sleep-time=MILLISECONDS   How long the sleep method takes. (1)" << std::endl;
+    ss << "  --host=HOST                 The host of the server. (127.0.0.1)" << std::endl;
+    ss << "  --port=PORT                 The port of the server. (8197)" << std::endl;
+    ss << "  --websocket-path=PATH       The path of the WebSocket route. (/)" << std::endl;
+    ss << "  --post-path=PATH            The path of the POST route. (/post)" << std::endl;
+    return ss.str();
+}
+
+
+ofJson LoadGeneratorSettings::toJSON(const LoadGeneratorSettings& settings)
+{
+    ofJson json;
+    json["transport"] = settings.transport == Transport::WEBSOCKET ? "websocket" : "post";
+    json["connections"] = settings.numConnections;
+    json["pipeline"] = settings.pipelineDepth;
+    json["batch"] = settings.batchSize;
+    json["payload"] = settings.payloadSize;
+
+    ofJson mix = ofJson::object();
+
+    for (const auto& entry: settings.methodMix)
+    {
+        mix[entry.method] = entry.weight;
+    }
+
+    json["mix"] = mix;
+    json["duration"] = settings.duration.count() / 1000.0;
+    json["callTimeout"] = settings.callTimeout.count() / 1000.0;
+    json["workers"] = settings.numWorkerThreads;
+    json["sleepTime"] = settings.sleepTime.count() / 1000.0;
+    return json;
+}
+
+
+LoadGenerator::LoadGenerator(const LoadGeneratorSettings& settings):
+    _settings(settings),
+    _numRequests(0),
+    _numCalls(0),
+    _numErrors(0),
+    _numTimedOut(0),
+    _numConnectionErrors(0),
+    _numRunningClients(0),
+    _isStopped(false)
+{
+    _params["text"] = std::string(_settings.payloadSize, 'x');
+}
+
+
+LoadGenerator::~LoadGenerator()
+{
+    stop();
+}
+
+
+ofJson LoadGenerator::run()
+{
+    // HTTP requests cannot be pipelined, so POST requests in flight are
+    // spread over more connections.
+    bool isPost = _settings.transport == LoadGeneratorSettings::Transport::POST;
+    std::size_t numClients = isPost ? _settings.numConnections * _settings.pipelineDepth : _settings.numConnections;
+
+    _numRunningClients = numClients;
+
+    std::vector<std::thread> threads;
+
+    Clock::time_point startTime = Clock::now();
+
+    for (std::size_t i = 0; i < numClients; ++i)
+    {
+        threads.emplace_back([this, isPost, i]() {
+            if (isPost)
+            {
+                runPostClient(i);
+            }
+            else
+            {
+                runWebSocketClient(i);
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            --_numRunningClients;
+            _condition.notify_all();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait_for(lock, _settings.duration, [this]() {
+            return _isStopped || _numRunningClients == 0;
+        });
+        _isStopped = true;
+    }
+
+    Clock::time_point stopTime = Clock::now();
+
+    for (auto& thread: threads)
+    {
+        thread.join();
+    }
+
+    double elapsedSeconds = std::chrono::duration<double>(stopTime - startTime).count();
+
+    ofJson json;
+    json["settings"] = LoadGeneratorSettings::toJSON(_settings);
+    json["elapsedTime"] = elapsedSeconds;
+    json["requests"] = _numRequests.load();
+    json["calls"] = _numCalls.load();
+    json["errors"] = _numErrors.load();
+    json["timedOut"] = _numTimedOut.load();
+    json["connectionErrors"] = _numConnectionErrors.load();
+    json["requestsPerSecond"] = elapsedSeconds > 0 ? _numRequests / elapsedSeconds : 0;
+    json["callsPerSecond"] = elapsedSeconds > 0 ? _numCalls / elapsedSeconds : 0;
+    json["latency"] = ofx::JSONRPC::LatencyHistogram::Snapshot::toJSON(_latencies.snapshot());
+    return json;
+}
+
+
+void LoadGenerator::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _isStopped = true;
+    }
+
+    _condition.notify_all();
+}
+
+
+void LoadGenerator::runWebSocketClient(std::size_t index)
+{
+    std::mt19937 random(static_cast<unsigned>(index));
+    std::discrete_distribution<std::size_t> methods = methodDistribution();
+
+    try
+    {
+        Poco::Net::HTTPClientSession session(_settings.host, _settings.port);
+        Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET,
+                                       _settings.webSocketPath,
+                                       Poco::Net::HTTPMessage::HTTP_1_1);
+        Poco::Net::HTTPResponse response;
+        Poco::Net::WebSocket socket(session, request, response);
+
+        // Wake up regularly to notice the end of the run.
+        socket.setReceiveTimeout(Poco::Timespan(0, 100000));
+
+        std::map<uint64_t, Clock::time_point> sentTimes;
+        std::size_t maxCallsInFlight = _settings.pipelineDepth * _settings.batchSize;
+        uint64_t nextId = 0;
+
+        Poco::Buffer<char> buffer(0);
+
+        while (!_isStopped)
+        {
+            expireCalls(sentTimes, Clock::now());
+
+            while (sentTimes.size() + _settings.batchSize <= maxCallsInFlight)
+            {
+                uint64_t firstId = nextId;
+                std::string text = makeRequest(random, methods, nextId).dump();
+                Clock::time_point now = Clock::now();
+
+                for (uint64_t id = firstId; id < nextId; ++id)
+                {
+                    sentTimes[id] = now;
+                }
+
+                socket.sendFrame(text.data(), int(text.size()), Poco::Net::WebSocket::FRAME_TEXT);
+                ++_numRequests;
+            }
+
+            int flags = 0;
+            int size = 0;
+
+            try
+            {
+                buffer.resize(0);
+                size = socket.receiveFrame(buffer, flags);
+            }
+            catch (const Poco::TimeoutException&)
+            {
+                continue;
+            }
+
+            int opcode = flags & Poco::Net::WebSocket::FRAME_OP_BITMASK;
+
+            if (size == 0 || opcode == Poco::Net::WebSocket::FRAME_OP_CLOSE)
+            {
+                if (!_isStopped)
+                {
+                    ofLogError("LoadGenerator::runWebSocketClient") << "Connection " << index << " was closed by the server.";
+                    ++_numConnectionErrors;
+                }
+
+                return;
+            }
+
+            if (opcode == Poco::Net::WebSocket::FRAME_OP_TEXT)
+            {
+                recordResponses(ofJson::parse(buffer.begin(), buffer.begin() + size), sentTimes, Clock::now());
+            }
+        }
+
+        socket.shutdown();
+    }
+    catch (const Poco::Exception& exc)
+    {
+        ofLogError("LoadGenerator::runWebSocketClient") << "Connection " << index << " failed: " << exc.displayText();
+        ++_numConnectionErrors;
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogError("LoadGenerator::runWebSocketClient") << "Connection " << index << " failed: " << exc.what();
+        ++_numConnectionErrors;
+    }
+}
+
+
+void LoadGenerator::runPostClient(std::size_t index)
+{
+    std::mt19937 random(static_cast<unsigned>(index));
+    std::discrete_distribution<std::size_t> methods = methodDistribution();
+
+    try
+    {
+        Poco::Net::HTTPClientSession session(_settings.host, _settings.port);
+        session.setKeepAlive(true);
+
+        // Requests are not pipelined, so a request that is not answered in
+        // time times out as a whole.
+        session.setTimeout(Poco::Timespan(std::chrono::duration_cast<std::chrono::microseconds>(_settings.callTimeout).count()));
+
+        uint64_t nextId = 0;
+
+        while (!_isStopped)
+        {
+            uint64_t firstId = nextId;
+            std::string body = makeRequest(random, methods, nextId).dump();
+
+            Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST,
+                                           _settings.postPath,
+                                           Poco::Net::HTTPMessage::HTTP_1_1);
+            request.setContentType("application/json");
+            request.setContentLength(body.size());
+            request.setKeepAlive(true);
+
+            std::map<uint64_t, Clock::time_point> sentTimes;
+            Clock::time_point now = Clock::now();
+
+            for (uint64_t id = firstId; id < nextId; ++id)
+            {
+                sentTimes[id] = now;
+            }
+
+            Poco::Net::HTTPResponse response;
+            std::string text;
+
+            try
+            {
+                session.sendRequest(request) << body;
+                ++_numRequests;
+
+                std::istream& stream = session.receiveResponse(response);
+                Poco::StreamCopier::copyToString(stream, text);
+            }
+            catch (const Poco::TimeoutException&)
+            {
+                if (!_isStopped)
+                {
+                    _numTimedOut += sentTimes.size();
+                }
+
+                // A late response must not be read as the next one.
+                session.reset();
+                continue;
+            }
+
+            if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK)
+            {
+                // Every call of the request failed.
+                if (!_isStopped)
+                {
+                    _numCalls += sentTimes.size();
+                    _numErrors += sentTimes.size();
+                }
+
+                continue;
+            }
+
+            recordResponses(ofJson::parse(text), sentTimes, Clock::now());
+        }
+    }
+    catch (const Poco::Exception& exc)
+    {
+        ofLogError("LoadGenerator::runPostClient") << "Connection " << index << " failed: " << exc.displayText();
+        ++_numConnectionErrors;
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogError("LoadGenerator::runPostClient") << "Connection " << index << " failed: " << exc.what();
+        ++_numConnectionErrors;
+    }
+}
+
+
+std::discrete_distribution<std::size_t> LoadGenerator::methodDistribution() const
+{
+    std::vector<double> weights;
+
+    for (const auto& entry: _settings.methodMix)
+    {
+        weights.push_back(entry.weight);
+    }
+
+    return std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+}
+
+
+ofJson LoadGenerator::makeRequest(std::mt19937& random,
+                                  std::discrete_distribution<std::size_t>& methods,
+                                  uint64_t& nextId) const
+{
+    ofJson batch = ofJson::array();
+
+    for (std::size_t i = 0; i < _settings.batchSize; ++i)
+    {
+        ofJson call;
+        call["jsonrpc"] = "2.0";
+        call["id"] = nextId++;
+        call["method"] = _settings.methodMix[methods(random)].method;
+        call["params"] = _params;
+        batch.push_back(call);
+    }
+
+    return _settings.batchSize > 1 ? batch : batch[0];
+}
+
+
+void LoadGenerator::recordResponses(const ofJson& json,
+                                    std::map<uint64_t, Clock::time_point>& sentTimes,
+                                    Clock::time_point now)
+{
+    if (json.is_array())
+    {
+        // A batch, or responses coalesced by the server.
+        for (const auto& element: json)
+        {
+            recordResponses(element, sentTimes, now);
+        }
+
+        return;
+    }
+
+    auto idIter = json.find("id");
+
+    if (idIter == json.end() || !idIter->is_number_unsigned())
+    {
+        ofLogWarning("LoadGenerator::recordResponses") << "Response has no call id: " << json.dump();
+        return;
+    }
+
+    auto sentTimeIter = sentTimes.find(idIter->get<uint64_t>());
+
+    if (sentTimeIter == sentTimes.end())
+    {
+        return;
+    }
+
+    // Calls answered after the end of the run are not counted.
+    if (!_isStopped)
+    {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - sentTimeIter->second);
+
+        _latencies.record(uint64_t(std::max(latency.count(), int64_t(0))));
+
+        ++_numCalls;
+
+        if (json.find("error") != json.end())
+        {
+            ++_numErrors;
+        }
+    }
+
+    sentTimes.erase(sentTimeIter);
+}
+
+
+void LoadGenerator::expireCalls(std::map<uint64_t, Clock::time_point>& sentTimes,
+                                Clock::time_point now)
+{
+    // Ids increase with the send time, so the oldest calls come first.
+    while (!sentTimes.empty() && now - sentTimes.begin()->second >= _settings.callTimeout)
+    {
+        if (!_isStopped)
+        {
+            ++_numTimedOut;
+        }
+
+        sentTimes.erase(sentTimes.begin());
+    }
+}
@@ -0,0 +1,234 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "ofJson.h"
+#include "ofx/JSONRPC/LatencyHistogram.h"
+
+
+/// \brief The settings of a load test.
+class LoadGeneratorSettings
+{
+public:
+    /// \brief The route that the calls are sent to.
+    enum class Transport
+    {
+        /// \brief Send calls in WebSocket text frames.
+        WEBSOCKET,
+        /// \brief Send calls in HTTP POST requests.
+        POST
+    };
+
+    /// \brief A method to call and its share of the calls.
+    struct MethodMixEntry
+    {
+        /// \brief The name of the method.
+        std::string method;
+
+        /// \brief The relative number of calls to the method.
+        double weight = 1;
+    };
+
+    /// \brief The host of the server.
+    std::string host = "127.0.0.1";
+
+    /// \brief The port of the server.
+    uint16_t port = 8197;
+
+    /// \brief The path of the WebSocket route.
+    ///
+    /// The local server's WebSocket route is set up with this path.
+    std::string webSocketPath = "/";
+
+    /// \brief The path of the POST route.
+    ///
+    /// The local server's POST route is set up with this path.
+    std::string postPath = "/post";
+
+    /// \brief The route that the calls are sent to.
+    Transport transport = Transport::WEBSOCKET;
+
+    /// \brief The number of concurrent connections.
+    std::size_t numConnections = 8;
+
+    /// \brief The maximum number of requests in flight on each connection.
+    ///
+    /// HTTP requests cannot be pipelined on one connection, so for POST
+    /// each connection is replaced by this many connections with one
+    /// request in flight.
+    std::size_t pipelineDepth = 1;
+
+    /// \brief The number of calls in each request.
+    ///
+    /// Requests with more than one call are sent as a batch.
+    std::size_t batchSize = 1;
+
+    /// \brief The size of the text parameter of each call in bytes.
+    std::size_t payloadSize = 16;
+
+    /// \brief The methods to call.
+    std::vector<MethodMixEntry> methodMix = { { "echo", 1 } };
+
+    /// \brief How long calls are sent.
+    std::chrono::milliseconds duration = std::chrono::milliseconds(10000);
+
+    /// \brief How long a call may wait for its response before it is
+    ///        counted as timed out.
+    ///
+    /// Timed out calls no longer count towards the calls in flight, so a
+    /// lost response does not stall its connection.
+    std::chrono::milliseconds callTimeout = std::chrono::milliseconds(5000);
+
+    /// \brief The number of worker threads of the local server, or 0 for
+    ///        the number of CPU cores.
+    std::size_t numWorkerThreads = 0;
+
+    /// \brief How long the "sleep" method of the local server takes.
+    std::chrono::milliseconds sleepTime = std::chrono::milliseconds(1);
+
+    /// \brief Create LoadGeneratorSettings from command line arguments.
+    ///
+    /// Each argument has the form --name=value, using the names listed by
+    /// usage(). Omitted options keep their default values.
+    ///
+    /// \param arguments The arguments, not including the program name.
+    /// \returns the settings.
+    /// \throws std::invalid_argument if an argument is unknown or its value
+    ///         is invalid.
+    static LoadGeneratorSettings fromArguments(const std::vector<std::string>& arguments);
+
+    /// \returns a description of the command line arguments.
+    static std::string usage();
+
+    /// \brief Serialize settings as a JSON object.
+    /// \param settings The settings to serialize.
+    /// \returns the JSON object.
+    static ofJson toJSON(const LoadGeneratorSettings& settings);
+
+};
+
+
+/// \brief Sends calls to a JSONRPCServer and measures their latency.
+///
+/// Each connection is served by its own thread, which keeps the configured
+/// number of requests in flight and records the time from sending each call
+/// to receiving its response. Responses may arrive in any order and may be
+/// coalesced into arrays by the server.
+class LoadGenerator
+{
+public:
+    /// \brief A typedef for the clock used to measure latencies.
+    typedef std::chrono::steady_clock Clock;
+
+    /// \brief Create a LoadGenerator.
+    /// \param settings The settings of the load test.
+    LoadGenerator(const LoadGeneratorSettings& settings);
+
+    /// \brief Destroy the LoadGenerator.
+    virtual ~LoadGenerator();
+
+    /// \brief Send calls for the configured duration.
+    ///
+    /// This blocks until every connection has stopped. Calls still in flight
+    /// when the duration has passed are not counted. Calls that are not
+    /// answered within the call timeout are counted as timed out instead of
+    /// as calls. A LoadGenerator runs only once, so that it can be stopped
+    /// before the run starts.
+    ///
+    /// \returns the report of the load test as a JSON object.
+    ofJson run();
+
+    /// \brief Stop a run before the duration has passed.
+    void stop();
+
+private:
+    /// \brief Send calls over one WebSocket connection until stopped.
+    /// \param index The index of the connection.
+    void runWebSocketClient(std::size_t index);
+
+    /// \brief Send calls in POST requests on one connection until stopped.
+    /// \param index The index of the connection.
+    void runPostClient(std::size_t index);
+
+    /// \returns a distribution that selects methods by their weight in the
+    ///          method mix.
+    std::discrete_distribution<std::size_t> methodDistribution() const;
+
+    /// \brief Create the next request.
+    /// \param random The random number generator of the calling thread.
+    /// \param methods The method distribution of the calling thread.
+    /// \param nextId The id of the next call, advanced by the batch size.
+    /// \returns a request object, or a batch array of request objects.
+    ofJson makeRequest(std::mt19937& random,
+                       std::discrete_distribution<std::size_t>& methods,
+                       uint64_t& nextId) const;
+
+    /// \brief Record the responses to the calls of a request.
+    /// \param json A response object or an array of response objects.
+    /// \param sentTimes The send time of each call by id. Answered calls
+    ///        are removed.
+    /// \param now The time the responses were received.
+    void recordResponses(const ofJson& json,
+                         std::map<uint64_t, Clock::time_point>& sentTimes,
+                         Clock::time_point now);
+
+    /// \brief Count the calls that have waited longer than the call timeout
+    ///        as timed out.
+    /// \param sentTimes The send time of each call by id. Timed out calls
+    ///        are removed.
+    /// \param now The current time.
+    void expireCalls(std::map<uint64_t, Clock::time_point>& sentTimes,
+                     Clock::time_point now);
+
+    /// \brief The settings of the load test.
+    LoadGeneratorSettings _settings;
+
+    /// \brief The parameters sent with each call.
+    ofJson _params;
+
+    /// \brief The latency of each call in microseconds.
+    ofx::JSONRPC::LatencyHistogram _latencies;
+
+    /// \brief The number of requests sent.
+    std::atomic<uint64_t> _numRequests;
+
+    /// \brief The number of calls answered.
+    std::atomic<uint64_t> _numCalls;
+
+    /// \brief The number of calls answered with an error.
+    std::atomic<uint64_t> _numErrors;
+
+    /// \brief The number of calls that were not answered in time.
+    std::atomic<uint64_t> _numTimedOut;
+
+    /// \brief The number of connections that failed.
+    std::atomic<uint64_t> _numConnectionErrors;
+
+    /// \brief The number of connections that have not stopped.
+    std::atomic<std::size_t> _numRunningClients;
+
+    /// \brief True once the run should stop.
+    std::atomic<bool> _isStopped;
+
+    /// \brief The mutex used to wait for the end of a run.
+    std::mutex _mutex;
+
+    /// \brief Notified when the run is stopped or every connection has
+    ///        stopped.
+    std::condition_variable _condition;
+
+};
@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include <iostream>
+#include "ofApp.h"
+#include "ofAppNoWindow.h"
+
+
+int main(int argc, char* argv[])
+{
+    LoadGeneratorSettings settings;
+
+    try
+    {
+        settings = LoadGeneratorSettings::fromArguments(std::vector<std::string>(argv + 1, argv + argc));
+    }
+    catch (const std::invalid_argument& exc)
+    {
+        std::cerr << exc.what() << std::endl << std::endl;
+        std::cerr << LoadGeneratorSettings::usage();
+        return 1;
+    }
+
+    ofAppNoWindow window;
+	ofSetupOpenGL(&window, 0, 0, OF_WINDOW);
+    return ofRunApp(std::make_shared<ofApp>(settings));
+}
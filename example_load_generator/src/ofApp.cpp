@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofApp.h"
+#include <thread>
+
+
+ofApp::ofApp(const LoadGeneratorSettings& settings): settings(settings)
+{
+}
+
+
+void ofApp::setup()
+{
+    ofSetFrameRate(30);
+
+    // Only the report is of interest.
+    ofSetLogLevel(OF_LOG_NOTICE);
+
+    ofx::HTTP::JSONRPCServerSettings serverSettings;
+    serverSettings.setPort(settings.port);
+    serverSettings.numWorkerThreads = settings.numWorkerThreads;
+    serverSettings.webSocketRouteSettings.setRoutePathPattern(settings.webSocketPath);
+    serverSettings.postRouteSettings.setRoutePathPattern(settings.postPath);
+
+    // Initialize the server.
+    server.setup(serverSettings);
+
+    // Register RPC methods.
+    server.registerMethod("echo",
+                          "Returns the parameters.",
+                          this,
+                          &ofApp::echo);
+
+    server.registerMethod("sleep",
+                          "Returns after the configured sleep time.",
+                          this,
+                          &ofApp::sleep);
+
+    // Start the server.
+    server.start();
+
+    // Run the load test without blocking the main thread, so that the
+    // server can still dispatch main thread work.
+    loadGenerator.reset(new LoadGenerator(settings));
+
+    report = std::async(std::launch::async, [this]() {
+        return loadGenerator->run();
+    });
+}
+
+
+void ofApp::update()
+{
+    if (report.valid() && report.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        ofJson json = report.get();
+
+        // Print the report so it can be piped to another tool, and save it
+        // so it can be compared with a later run.
+        std::cout << json.dump(4) << std::endl;
+
+        ofSavePrettyJson("report.json", json);
+
+        ofExit();
+    }
+}
+
+
+void ofApp::exit()
+{
+    // Stop a load test that is still running.
+    if (report.valid())
+    {
+        loadGenerator->stop();
+        report.wait();
+    }
+
+    // Set the logger back to the default to make sure any
+    // remaining messages are logged correctly.
+    ofLogToConsole();
+}
+
+
+void ofApp::echo(ofx::JSONRPC::MethodArgs& args)
+{
+    args.result = args.params;
+}
+
+
+void ofApp::sleep(ofx::JSONRPC::MethodArgs& args)
+{
+    std::this_thread::sleep_for(settings.sleepTime);
+}
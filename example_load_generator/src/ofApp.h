@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <future>
+#include "ofMain.h"
+#include "ofxJSONRPC.h"
+#include "LoadGenerator.h"
+
+
+class ofApp: public ofBaseApp
+{
+public:
+    /// \brief Create an ofApp.
+    /// \param settings The settings of the load test.
+    ofApp(const LoadGeneratorSettings& settings);
+
+    void setup() override;
+    void update() override;
+    void exit() override;
+
+    // Registered methods.
+    void echo(ofx::JSONRPC::MethodArgs& args);
+    void sleep(ofx::JSONRPC::MethodArgs& args);
+
+    /// \brief The settings of the load test.
+    LoadGeneratorSettings settings;
+
+    /// \brief The local server that receives the calls.
+    ofx::HTTP::JSONRPCServer server;
+
+    /// \brief The load generator that sends the calls.
+    std::unique_ptr<LoadGenerator> loadGenerator;
+
+    /// \brief The report of the load test, once it has finished.
+    std::future<ofJson> report;
+
+};
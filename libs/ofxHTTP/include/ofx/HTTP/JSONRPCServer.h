@@ -7,25 +7,193 @@
 #pragma once
 
 
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
 #include "ofTypes.h"
 #include "ofx/HTTP/BaseServer.h"
 #include "ofx/HTTP/FileSystemRoute.h"
+#include "ofx/HTTP/JSONRPCWebSocketRoute.h"
+#include "ofx/HTTP/MetricsRoute.h"
 #include "ofx/HTTP/PostRoute.h"
 #include "ofx/HTTP/WebSocketConnection.h"
 #include "ofx/HTTP/WebSocketRoute.h"
 #include "ofx/JSONRPC/MethodRegistry.h"
+#include "ofx/JSONRPC/Scheduler.h"
+#include "ofx/JSONRPC/TaskQueue.h"
+#include "ofx/JSONRPC/ThreadPool.h"
 
 
 namespace ofx {
 namespace HTTP {
 
 
+/// \brief What to do with frames sent to a congested WebSocket connection.
+enum class BackpressurePolicy
+{
+    /// \brief Drop notifications and broadcasts until the connection's send
+    ///        queue drains. Responses are always sent.
+    DROP,
+    /// \brief Close the connection immediately and drop all later frames.
+    CLOSE
+};
+
+
 class JSONRPCServerSettings: public BaseServerSettings
 {
 public:
     FileSystemRouteSettings fileSystemRouteSettings;
     PostRouteSettings postRouteSettings;
     WebSocketRouteSettings webSocketRouteSettings;
+    MetricsRouteSettings metricsRouteSettings;
+
+    /// \brief The number of worker threads used to process requests.
+    ///
+    /// The elements of a batch request are processed concurrently by the
+    /// worker threads. If zero, the number of hardware threads will be used.
+    ///
+    /// A new number of worker threads only takes effect while the server is
+    /// stopped and has no open connections, because work in progress refers
+    /// to the current threads.
+    std::size_t numWorkerThreads = 0;
+
+    /// \brief True if the elements of a batch request should be processed
+    ///        concurrently.
+    bool processBatchesInParallel = true;
+
+    /// \brief True if notifications should be queued on the worker threads.
+    ///
+    /// Queued notifications are fire-and-forget and the receiving thread
+    /// returns immediately. Methods called by queued notifications must not
+    /// access the originating ServerEventArgs.
+    bool processNotificationsInBackground = false;
+
+    /// \brief True if WebSocket frames should be processed on the worker
+    ///        threads.
+    ///
+    /// If false, each frame is processed on its connection's thread and a
+    /// slow call delays all later frames from that connection.
+    bool processFramesInBackground = false;
+
+    /// \brief True if frames processed in the background should be
+    ///        processed in the order they were received on each connection.
+    ///
+    /// If false, the frames of a single connection may be processed
+    /// concurrently and their responses may be sent in any order.
+    bool preserveFrameOrder = true;
+
+    /// \brief The maximum send queue size of a connection that receives
+    ///        broadcasts.
+    ///
+    /// Broadcasts skip connections that have more frames waiting to be sent
+    /// than this, so that slow consumers do not accumulate unbounded
+    /// backlogs. If zero, no connections are skipped.
+    std::size_t maxBroadcastSendQueueSize = 64;
+
+    /// \brief The send queue size at which a connection becomes congested.
+    ///
+    /// Frames sent to a congested connection are handled according to the
+    /// backpressurePolicy. If zero, send queues are unbounded.
+    std::size_t sendQueueHighWaterMark = 256;
+
+    /// \brief The send queue size at which a congested connection recovers.
+    ///
+    /// The gap between the water marks keeps a connection from switching
+    /// between states on every frame.
+    std::size_t sendQueueLowWaterMark = 128;
+
+    /// \brief What to do with frames sent to a congested connection.
+    BackpressurePolicy backpressurePolicy = BackpressurePolicy::DROP;
+
+    /// \brief The time in microseconds that a WebSocket response may be held
+    ///        back to be sent together with later responses.
+    ///
+    /// Responses to the same connection that complete within this time are
+    /// sent as a single array frame, as if they answered a batch request.
+    /// This trades latency for fewer frames on busy connections. If zero,
+    /// each response is sent in its own frame as soon as it completes.
+    ///
+    /// Only clients that negotiated a subprotocol with the
+    /// JSONRPC::JSONRPCUtils::COALESCE_SUBPROTOCOL_SUFFIX expect arrays in
+    /// answer to single requests, so other connections are never coalesced.
+    uint64_t responseCoalescingDelay = 0;
+
+    /// \brief The maximum number of responses coalesced into one frame.
+    ///
+    /// Held back responses are sent immediately once there are this many.
+    std::size_t maxCoalescedResponses = 64;
+
+    /// \brief The limit on calls in progress across all methods.
+    ///
+    /// Calls over the limit are queued or rejected with
+    /// JSONRPC::Errors::RPC_ERROR_SERVER_BUSY so that a burst of expensive
+    /// calls cannot occupy every server thread. Limits for single methods
+    /// are set with setConcurrencyPolicy(). Disabled by default.
+    ///
+    /// setup() changes the limit in place, so calls already in progress
+    /// count towards the new limit.
+    JSONRPC::ConcurrencyPolicy concurrencyPolicy;
+
+    /// \brief True if the built-in subscription methods are registered.
+    ///
+    /// WebSocket clients call rpc.subscribe and rpc.unsubscribe with an
+    /// array of topic names to choose which published topics they receive.
+    /// Disabled by default, because any client may subscribe to any topic.
+    bool enableSubscriptions = false;
+
+    /// \brief The maximum number of topics a connection may subscribe to.
+    ///
+    /// Subscriptions that would exceed it are rejected as a whole, so that a
+    /// client cannot make the server track an unbounded number of topics.
+    /// If zero, the number of topics is not limited.
+    std::size_t maxTopicsPerConnection = 64;
+
+    /// \brief The time in milliseconds that a call may take before it is
+    ///        cancelled.
+    ///
+    /// Calls that exceed it are answered with
+    /// JSONRPC::Errors::RPC_ERROR_DEADLINE_EXCEEDED. If zero, calls have no
+    /// deadline.
+    uint64_t callTimeout = 0;
+
+    /// \brief True if calls on WebSocket connections can be cancelled.
+    ///
+    /// The built-in $/cancelRequest method is registered and WebSocket
+    /// clients send it with the id of a call in progress, e.g.
+    /// {"jsonrpc": "2.0", "method": "$/cancelRequest", "params": {"id": 1}},
+    /// to cancel the call. Calls in progress are also cancelled when their
+    /// connection closes. Disabled by default, because every call then
+    /// registers its id with its connection.
+    bool enableCancellation = false;
+
+    /// \brief True if calls are counted and timed.
+    ///
+    /// The latency of each call is recorded separately for parsing,
+    /// queueing, the method itself, serializing and sending, see
+    /// JSONRPC::MethodStats. The statistics are read with methodStats().
+    bool enableStats = false;
+
+    /// \brief True if the built-in rpc.stats method is registered.
+    ///
+    /// The method returns the statistics of the methods named in its params
+    /// array, or of all methods if there are no params. It is only
+    /// registered if enableStats is true.
+    bool enableStatsMethod = false;
+
+    /// \brief True if the metrics route is attached to the server.
+    ///
+    /// The route, /metrics by default, exposes the server's metrics in the
+    /// OpenMetrics text format so that they can be scraped by Prometheus.
+    /// Per-method metrics are only included if enableStats is true.
+    bool enableMetricsRoute = false;
 };
 
 
@@ -33,6 +201,61 @@ public:
 ///
 /// This server can process JSONRPC calls submitted via WebSockets or
 /// POST requests.
+///
+/// Both single requests and batch requests (arrays of requests) are
+/// supported. The elements of a batch are processed concurrently and their
+/// responses are returned together in a single WebSocket frame or POST
+/// response body.
+///
+/// Deferred methods (see JSONRPC::DeferredMethodArgs) do not occupy a server
+/// thread while they are in progress when called via WebSockets. The
+/// response is sent to the WebSocket connection when the method completes,
+/// as long as the connection is still open. POST requests wait for deferred
+/// methods to complete before responding.
+///
+/// Methods always receive the server as their pSender. Methods called via
+/// WebSockets find the calling connection in JSONRPC::MethodArgs::connection
+/// and JSONRPC::MethodArgs::connectionId.
+///
+/// WebSocket clients can subscribe to topics with the built-in
+/// rpc.subscribe and rpc.unsubscribe methods. The application sends a
+/// notification to all subscribers of a topic with publish().
+///
+/// Each call's JSONRPC::MethodArgs carry a cancellation token and deadline.
+/// The token is cancelled when the callTimeout passes and, if
+/// enableCancellation is set, when the calling WebSocket connection closes
+/// or the client sends $/cancelRequest with the call's id. Cancelled calls
+/// are answered immediately and methods that check the token can stop
+/// early.
+///
+/// If enableStats is set, every call is counted and timed per method and
+/// phase. The statistics are available with methodStats() and, optionally,
+/// to clients with the built-in rpc.stats method.
+///
+/// If enableMetricsRoute is set, the server's metrics are also exposed in the
+/// OpenMetrics text format, see writeMetrics().
+///
+/// If a responseCoalescingDelay is set, the responses to a WebSocket
+/// connection that negotiated coalescing and complete within that time are
+/// sent together as one array frame. Batch responses and notifications are
+/// never held back.
+///
+/// Every frame sent to a WebSocket connection is checked against the
+/// connection's send queue. A connection whose queue reaches the high water
+/// mark is congested until the queue drains to the low water mark. In the
+/// meantime notifications and broadcasts sent to it are dropped, or the
+/// connection is closed, so that a slow client cannot make the server buffer
+/// without bound. Responses are never dropped from an open connection,
+/// because their clients wait for them. See sendQueueStats().
+///
+/// WebSocket clients may request a binary encoding by offering the
+/// JSONRPC::JSONRPCUtils::CBOR_SUBPROTOCOL or
+/// JSONRPC::JSONRPCUtils::MESSAGE_PACK_SUBPROTOCOL subprotocol. Binary
+/// frames received on such a connection are decoded in that encoding and
+/// answered with binary frames in the same encoding. Text frames are always
+/// JSON and are answered with text frames. The first supported subprotocol
+/// offered is confirmed in the handshake response and unsupported offers
+/// are ignored, see JSONRPCWebSocketRoute.
 template <typename SessionStoreType>
 class JSONRPCServer_:
     public BaseServer_<JSONRPCServerSettings, SessionStoreType>,
@@ -55,6 +278,12 @@ public:
     /// \param settings configure the JSONRPCServer with the given settings.
     virtual void setup(const Settings& settings);
 
+    /// \brief Start the JSONRPCServer.
+    ///
+    /// A change to the number of worker threads that was deferred because
+    /// the server was running is applied before the server starts.
+    virtual void start() override;
+
     /// \brief Get the PostRoute.
     /// \returns the PostRoute attached to this server.
     FileSystemRoute& fileSystemRoute();
@@ -67,6 +296,188 @@ public:
     /// \returns the WebSocketRoute attached to this server.
     WebSocketRoute& webSocketRoute();
 
+    /// \brief Get the worker threads used to process requests.
+    ///
+    /// Deferred and coroutine methods can use the pool to continue work
+    /// without occupying a server thread, e.g. with JSONRPC::resumeOn().
+    ///
+    /// The pool is replaced when the number of worker threads changes, which
+    /// only happens while the server is stopped, so the reference must not
+    /// be kept across a restart.
+    ///
+    /// \returns the ThreadPool used by this server.
+    JSONRPC::ThreadPool& threadPool();
+
+    /// \brief Send a frame to a WebSocket connection if it is still open.
+    ///
+    /// This is safe to call from any thread, even if the connection has
+    /// closed. Like a notification, the frame is dropped if the connection
+    /// is congested.
+    ///
+    /// \param connection The connection to send the frame to.
+    /// \param frame The frame to send.
+    /// \returns true iff the connection was open and the frame was sent.
+    bool sendFrame(const WebSocketConnection* connection,
+                   const WebSocketFrame& frame);
+
+    /// \brief Counters for the frames sent to WebSocket connections.
+    struct SendQueueStats
+    {
+        /// \brief The number of frames sent.
+        uint64_t numFramesSent = 0;
+
+        /// \brief The number of bytes sent, excluding WebSocket headers.
+        uint64_t numBytesSent = 0;
+
+        /// \brief The number of frames dropped.
+        uint64_t numFramesDropped = 0;
+
+        /// \brief The number of times a connection became congested.
+        uint64_t numCongestionEvents = 0;
+
+        /// \brief The number of connections closed by the CLOSE policy.
+        uint64_t numConnectionsClosed = 0;
+
+        /// \brief The number of open connections that are congested now.
+        std::size_t numCongestedConnections = 0;
+
+        /// \brief Add the counters of other stats.
+        /// \param other The stats to add.
+        /// \returns this stats.
+        SendQueueStats& operator += (const SendQueueStats& other)
+        {
+            numFramesSent += other.numFramesSent;
+            numBytesSent += other.numBytesSent;
+            numFramesDropped += other.numFramesDropped;
+            numCongestionEvents += other.numCongestionEvents;
+            numConnectionsClosed += other.numConnectionsClosed;
+            numCongestedConnections += other.numCongestedConnections;
+            return *this;
+        }
+    };
+
+    /// \brief Get the send counters of all connections since the server was
+    ///        created.
+    /// \returns the counters.
+    SendQueueStats sendQueueStats() const;
+
+    /// \brief Get the send counters of an open connection.
+    /// \param connection The connection.
+    /// \returns the counters, or empty counters if the connection is not open.
+    SendQueueStats sendQueueStats(const WebSocketConnection* connection) const;
+
+    /// \brief Write the server's metrics in the OpenMetrics text format.
+    ///
+    /// The metric families are:
+    ///
+    /// - jsonrpc_calls, jsonrpc_notifications and jsonrpc_errors counters
+    ///   and the jsonrpc_active_calls gauge, by method;
+    /// - the jsonrpc_call_duration_seconds histogram, by method and phase;
+    /// - the jsonrpc_queued_calls gauge and jsonrpc_rejected_calls counter
+    ///   of the global concurrency limit;
+    /// - WebSocket connection, send queue and send counters.
+    ///
+    /// Per-method families are empty unless statistics are enabled. The
+    /// terminating "# EOF" line is not written.
+    ///
+    /// \param stream The stream to write to.
+    void writeMetrics(std::ostream& stream) const;
+
+    /// \brief A callback that selects the connections that receive a
+    ///        broadcast.
+    typedef std::function<bool(const WebSocketConnection& connection)> ConnectionFilter;
+
+    /// \brief Send a notification to all open WebSocket connections.
+    ///
+    /// The notification is serialized once for each encoding in use, but
+    /// each connection's send queue holds its own copy of the frame.
+    /// Connections that negotiated a binary encoding receive binary frames.
+    ///
+    /// This is safe to call from any thread. The frames are sent after the
+    /// connections are unlocked, so a connection that closes meanwhile is
+    /// skipped.
+    ///
+    /// \param method The name of the method to notify.
+    /// \param params The parameters of the notification.
+    /// \param filter If set, only connections for which the filter returns
+    ///        true receive the notification. The filter is called while the
+    ///        connections are locked and must not call back into the server.
+    /// \returns the number of connections the notification was sent to.
+    std::size_t broadcastNotification(const std::string& method,
+                                      const ofJson& params = nullptr,
+                                      ConnectionFilter filter = nullptr);
+
+    /// \brief Send a notification to the subscribers of a topic.
+    ///
+    /// The notification's method is the topic name. Like broadcasts, it is
+    /// serialized once per encoding, slow connections are skipped and the
+    /// frames are sent after the connections are unlocked.
+    ///
+    /// This is safe to call from any thread.
+    ///
+    /// \param topic The topic to publish.
+    /// \param params The parameters of the notification.
+    /// \returns the number of connections the notification was sent to.
+    std::size_t publish(const std::string& topic,
+                        const ofJson& params = nullptr);
+
+    /// \brief Get the number of connections subscribed to a topic.
+    /// \param topic The topic.
+    /// \returns the number of subscribed connections.
+    std::size_t numSubscribers(const std::string& topic) const;
+
+    /// \brief Subscribe the calling WebSocket connection to topics.
+    ///
+    /// The params are an array of topic names. The result is the array of
+    /// all topics the connection is subscribed to.
+    ///
+    /// \param pSender The server.
+    /// \param args The method arguments.
+    void onSubscribe(const void* pSender, JSONRPC::MethodArgs& args);
+
+    /// \brief Unsubscribe the calling WebSocket connection from topics.
+    ///
+    /// The params are an array of topic names. The result is the array of
+    /// all topics the connection is still subscribed to.
+    ///
+    /// \param pSender The server.
+    /// \param args The method arguments.
+    void onUnsubscribe(const void* pSender, JSONRPC::MethodArgs& args);
+
+    /// \brief Cancel a call in progress on the calling WebSocket connection.
+    ///
+    /// The params are an object with the id of the call to cancel. The
+    /// result is true if the call was cancelled.
+    ///
+    /// \param pSender The server.
+    /// \param args The method arguments.
+    void onCancelRequest(const void* pSender, JSONRPC::MethodArgs& args);
+
+    /// \brief Get the call statistics of methods.
+    ///
+    /// The params are an optional array of method names. The result is an
+    /// object with the statistics of each named method, or of all methods
+    /// if there are no params, see JSONRPC::MethodStats::Snapshot::toJSON().
+    ///
+    /// \param args The method arguments.
+    void onStats(JSONRPC::MethodArgs& args);
+
+    /// \brief The name of the built-in subscribe method.
+    static const std::string SUBSCRIBE_METHOD;
+
+    /// \brief The name of the built-in unsubscribe method.
+    static const std::string UNSUBSCRIBE_METHOD;
+
+    /// \brief The name of the built-in cancel method.
+    static const std::string CANCEL_REQUEST_METHOD;
+
+    /// \brief The name of the built-in stats method.
+    static const std::string STATS_METHOD;
+
+    /// \brief The maximum number of cancelled calls remembered per
+    ///        connection before they start.
+    static const std::size_t MAX_CANCELLED_CALL_IDS;
+
     bool onWebSocketOpenEvent(WebSocketOpenEventArgs& evt);
     bool onWebSocketCloseEvent(WebSocketCloseEventArgs& evt);
     bool onWebSocketFrameReceivedEvent(WebSocketFrameEventArgs& evt);
@@ -78,6 +489,303 @@ public:
     bool onHTTPUploadEvent(PostUploadEventArgs& evt);
 
 protected:
+    /// \brief The state of an open WebSocket connection.
+    ///
+    /// The state is shared with the calls, frames and flushes in progress on
+    /// the connection, which must check isOpen before using the connection
+    /// because the state outlives it. The topics are protected by the
+    /// connections mutex and all other members by the state's mutex. The
+    /// connections mutex is always locked first.
+    struct ConnectionState
+    {
+        /// \brief The connection, valid while isOpen is true.
+        WebSocketConnection* connection = nullptr;
+
+        /// \brief The id of the connection, unique among all connections of
+        ///        the server.
+        uint64_t id = 0;
+
+        /// \brief True until the connection closes.
+        bool isOpen = true;
+
+        /// \brief The mutex that protects the state.
+        std::mutex mutex;
+
+        /// \brief The encoding of binary frames, negotiated on open.
+        JSONRPC::Encoding binaryEncoding = JSONRPC::Encoding::JSON;
+
+        /// \brief True if the client accepts coalesced responses, negotiated
+        ///        on open.
+        bool isCoalescing = false;
+
+        /// \brief The queue of frames processed in the background.
+        std::shared_ptr<JSONRPC::TaskQueue> taskQueue;
+
+        /// \brief The topics the connection is subscribed to.
+        std::set<std::string> topics;
+
+        /// \brief The cancellation tokens of the calls in progress, by their
+        ///        serialized id.
+        std::unordered_map<std::string, JSONRPC::CancellationToken> activeCalls;
+
+        /// \brief The serialized ids of queued calls that were cancelled
+        ///        before they started, oldest first.
+        ///
+        /// Each id is paired with the number of frames queued when it was
+        /// cancelled. Only calls from those earlier frames are cancelled, so
+        /// an id expires once a later frame starts.
+        std::deque<std::pair<std::string, uint64_t>> cancelledCallIds;
+
+        /// \brief The number of frames received for background processing.
+        uint64_t numFramesQueued = 0;
+
+        /// \brief True while the connection's send queue is above the low
+        ///        water mark after reaching the high water mark.
+        bool isCongested = false;
+
+        /// \brief True once the connection has been closed by the CLOSE
+        ///        policy.
+        bool isClosing = false;
+
+        /// \brief The send counters of the connection.
+        SendQueueStats stats;
+
+        /// \brief The responses held back to be coalesced, in text frames
+        ///        and in binary frames.
+        std::array<std::vector<std::string>, 2> coalescedResponses;
+
+        /// \brief True while a flush of the coalesced responses is scheduled.
+        bool isFlushScheduled = false;
+    };
+
+    /// \brief A typedef for a shared ConnectionState.
+    typedef std::shared_ptr<ConnectionState> SharedConnectionStatePtr;
+
+    /// \brief A callback that receives a serialized response.
+    ///
+    /// The buffer is empty if nothing should be sent.
+    typedef std::function<void(std::string& buffer)> ResponseBufferHandler;
+
+    /// \brief Process a parsed JSONRPC message.
+    /// \param pSender The sender passed to the methods, usually the server.
+    /// \param evt The originating server event.
+    /// \param json A single request object or a batch array of requests.
+    /// \param encoding The encoding of the serialized response.
+    /// \param responseHandler The callback that receives the serialized
+    ///        response exactly once. The buffer is empty if the message
+    ///        contained only notifications and nothing should be sent.
+    /// \param parseTime The time spent decoding the message, recorded in
+    ///        the statistics of its methods.
+    /// \param connectionState The state of the calling WebSocket connection,
+    ///        or nullptr for other requests.
+    /// \param receivedTime The time the message was received, if statistics
+    ///        are enabled. The queue phase of its calls starts then.
+    void processMessage(const void* pSender,
+                        ServerEventArgs& evt,
+                        ofJson&& json,
+                        JSONRPC::Encoding encoding,
+                        ResponseBufferHandler responseHandler,
+                        JSONRPC::MethodStats::Clock::duration parseTime = JSONRPC::MethodStats::Clock::duration::zero(),
+                        SharedConnectionStatePtr connectionState = nullptr,
+                        JSONRPC::MethodStats::Clock::time_point receivedTime = JSONRPC::MethodStats::Clock::time_point());
+
+    /// \brief Process a single request object.
+    /// \param pSender The sender passed to the methods.
+    /// \param evt The originating server event.
+    /// \param json The request object.
+    /// \param encoding The encoding of the serialized response.
+    /// \param responseHandler The callback that receives the serialized
+    ///        response exactly once. The buffer is empty if the request was
+    ///        a notification.
+    /// \param parseTime The time spent decoding the request object.
+    /// \param connectionState The state of the calling WebSocket connection,
+    ///        or nullptr for other requests.
+    /// \param receivedTime The time the message was received, if statistics
+    ///        are enabled. The queue phase of its calls starts then.
+    void processRequest(const void* pSender,
+                        ServerEventArgs& evt,
+                        ofJson&& json,
+                        JSONRPC::Encoding encoding,
+                        ResponseBufferHandler responseHandler,
+                        JSONRPC::MethodStats::Clock::duration parseTime = JSONRPC::MethodStats::Clock::duration::zero(),
+                        SharedConnectionStatePtr connectionState = nullptr,
+                        JSONRPC::MethodStats::Clock::time_point receivedTime = JSONRPC::MethodStats::Clock::time_point());
+
+    /// \brief Process a batch of request objects.
+    /// \param pSender The sender passed to the methods.
+    /// \param evt The originating server event.
+    /// \param json The non-empty array of request objects.
+    /// \param encoding The encoding of the serialized response.
+    /// \param responseHandler The callback that receives the serialized
+    ///        array of responses exactly once, after every element has
+    ///        completed. The buffer is empty if the batch contained only
+    ///        notifications.
+    /// \param parseTime The time spent decoding the batch, shared equally
+    ///        by its elements.
+    /// \param connectionState The state of the calling WebSocket connection,
+    ///        or nullptr for other requests.
+    /// \param receivedTime The time the message was received, if statistics
+    ///        are enabled. The queue phase of its calls starts then.
+    void processBatch(const void* pSender,
+                      ServerEventArgs& evt,
+                      ofJson&& json,
+                      JSONRPC::Encoding encoding,
+                      ResponseBufferHandler responseHandler,
+                      JSONRPC::MethodStats::Clock::duration parseTime = JSONRPC::MethodStats::Clock::duration::zero(),
+                      SharedConnectionStatePtr connectionState = nullptr,
+                      JSONRPC::MethodStats::Clock::time_point receivedTime = JSONRPC::MethodStats::Clock::time_point());
+
+    /// \brief Parse and process a WebSocket frame.
+    /// \param evt The originating server event.
+    /// \param connectionState The state of the connection that received the
+    ///        frame, or nullptr if it is unknown.
+    /// \param frame The received frame.
+    /// \param encoding The encoding of the frame.
+    /// \param receivedTime The time the frame was received, if statistics
+    ///        are enabled.
+    /// \returns true iff the frame could be parsed.
+    bool processFrame(ServerEventArgs& evt,
+                      SharedConnectionStatePtr connectionState,
+                      const WebSocketFrame& frame,
+                      JSONRPC::Encoding encoding,
+                      JSONRPC::MethodStats::Clock::time_point receivedTime);
+
+    /// \brief Parse a WebSocket frame, logging frames that are invalid.
+    /// \param frame The received frame.
+    /// \param encoding The encoding of the frame.
+    /// \param json The parsed message.
+    /// \param parseTime The time spent parsing, if statistics are enabled.
+    /// \returns true iff the frame could be parsed.
+    bool parseFrame(const WebSocketFrame& frame,
+                    JSONRPC::Encoding encoding,
+                    ofJson& json,
+                    JSONRPC::MethodStats::Clock::duration& parseTime);
+
+    /// \brief Process a parsed WebSocket message.
+    /// \param evt The originating server event.
+    /// \param connectionState The state of the connection that received the
+    ///        frame, or nullptr if it is unknown.
+    /// \param json The parsed message.
+    /// \param isBinary True if the message was received in a binary frame.
+    /// \param encoding The encoding of the frame.
+    /// \param parseTime The time spent parsing the frame.
+    /// \param receivedTime The time the frame was received, if statistics
+    ///        are enabled.
+    void processParsedFrame(ServerEventArgs& evt,
+                            SharedConnectionStatePtr connectionState,
+                            ofJson&& json,
+                            bool isBinary,
+                            JSONRPC::Encoding encoding,
+                            JSONRPC::MethodStats::Clock::duration parseTime,
+                            JSONRPC::MethodStats::Clock::time_point receivedTime);
+
+    /// \brief Expire the cancelled call ids that a queued frame cannot
+    ///        match, before the frame is processed.
+    /// \param connectionState The state of the connection.
+    /// \param frameIndex The index of the frame among the queued frames.
+    void startQueuedFrame(ConnectionState& connectionState, uint64_t frameIndex);
+
+    /// \brief Send a response to a connection, coalescing it with other
+    ///        responses if enabled.
+    /// \param connectionState The state of the connection to send to.
+    /// \param buffer The serialized response.
+    /// \param isBinary True if the response is sent in a binary frame, in
+    ///        the connection's binary encoding.
+    /// \param isBatch True if the response is a batch response array.
+    /// \returns true iff the connection was open and the response was sent
+    ///          or held back.
+    bool sendResponse(const SharedConnectionStatePtr& connectionState,
+                      std::string& buffer,
+                      bool isBinary,
+                      bool isBatch);
+
+    /// \brief Send the coalesced responses of a connection.
+    ///
+    /// This must be called while holding the state's mutex.
+    ///
+    /// \param state The state of the connection to send to.
+    void flushResponses(ConnectionState& state);
+
+    /// \brief Send a frame to a connection, applying the backpressure policy.
+    ///
+    /// This must be called while holding the state's mutex. Every frame sent
+    /// to a WebSocket connection goes through this function.
+    ///
+    /// \param state The state of the connection to send to.
+    /// \param frame The frame to send.
+    /// \param isDroppable True if the frame may be dropped while the
+    ///        connection is congested, as for notifications. Responses are
+    ///        not droppable.
+    /// \returns true iff the connection was open and the frame was sent.
+    bool writeFrame(ConnectionState& state,
+                    const WebSocketFrame& frame,
+                    bool isDroppable);
+
+    /// \brief The frames of a notification, indexed by encoding.
+    typedef std::array<std::unique_ptr<WebSocketFrame>, 3> NotificationFrames;
+
+    /// \brief Send a notification to a connection unless it is too slow.
+    ///
+    /// This must be called while holding the state's mutex.
+    ///
+    /// \param state The state of the connection to send to.
+    /// \param json The notification.
+    /// \param frames The frames of the notification. The frame for the
+    ///        connection's encoding is created if it does not exist yet.
+    /// \returns true iff the notification was sent.
+    bool sendNotification(ConnectionState& state,
+                          const ofJson& json,
+                          NotificationFrames& frames);
+
+    /// \brief Write a latency histogram in the OpenMetrics text format.
+    ///
+    /// The fine buckets of the histogram are summed into a fixed set of
+    /// buckets from 100 microseconds to 10 seconds.
+    ///
+    /// \param stream The stream to write to.
+    /// \param name The name of the metric family.
+    /// \param labels The labels of the histogram, without braces.
+    /// \param snapshot The histogram in microseconds.
+    static void writeHistogram(std::ostream& stream,
+                               const std::string& name,
+                               const std::string& labels,
+                               const JSONRPC::LatencyHistogram::Snapshot& snapshot);
+
+    /// \brief Create new worker threads if their number has changed.
+    ///
+    /// Batches, frame queues, notifications and coroutines in progress refer
+    /// to the current pool, so it is only replaced while the server is
+    /// stopped and has no open connections. Otherwise the change is deferred
+    /// until the server is started again.
+    void setupThreadPool();
+
+    /// \brief Register or unregister the built-in methods.
+    /// \param settings The server settings.
+    void setupBuiltInMethods(const Settings& settings);
+
+    /// \brief Find the state of the WebSocket connection that sent a call.
+    ///
+    /// This must be called while holding the connections mutex.
+    ///
+    /// \param args The method arguments.
+    /// \returns the state of the open connection.
+    /// \throws JSONRPC::InvalidRequestException if the call was not sent
+    ///         over a WebSocket connection or the connection has closed.
+    SharedConnectionStatePtr findConnectionState(const JSONRPC::MethodArgs& args) const;
+
+    /// \brief Parse the topic names of a subscription call.
+    /// \param args The method arguments.
+    /// \returns the topic names.
+    /// \throws JSONRPC::InvalidParametersException if the params are not an
+    ///         array of strings.
+    static std::vector<std::string> topicsFromArgs(const JSONRPC::MethodArgs& args);
+
+    /// \brief The worker threads used to process requests.
+    std::unique_ptr<JSONRPC::ThreadPool> _threadPool;
+
+    /// \brief The number of worker threads the pool was created with.
+    std::size_t _numWorkerThreads = 0;
+
     /// \brief The FileSystemRoute attached to this server.
     FileSystemRoute _fileSystemRoute;
 
@@ -85,7 +793,34 @@ protected:
     PostRoute _postRoute;
 
     /// \brief The WebSocketRoute attached to this server.
-    WebSocketRoute _webSocketRoute;
+    JSONRPCWebSocketRoute _webSocketRoute;
+
+    /// \brief The MetricsRoute attached to this server, if enabled.
+    MetricsRoute _metricsRoute;
+
+    /// \brief The currently open WebSocket connections and their state.
+    std::map<const WebSocketConnection*, SharedConnectionStatePtr> _connections;
+
+    /// \brief The subscribed connections by topic.
+    ///
+    /// This is protected by the connections mutex.
+    std::unordered_map<std::string, std::set<const WebSocketConnection*>> _subscribers;
+
+    /// \brief The id of the last connection opened.
+    ///
+    /// This is protected by the connections mutex.
+    uint64_t _lastConnectionId = 0;
+
+    /// \brief The send counters of the closed connections.
+    ///
+    /// This is protected by the connections mutex.
+    SendQueueStats _closedConnectionStats;
+
+    /// \brief The timer that flushes coalesced responses.
+    std::unique_ptr<JSONRPC::Scheduler> _scheduler;
+
+    /// \brief A mutex to protect the open connections.
+    mutable std::mutex _connectionsMutex;
 
 };
 
@@ -93,19 +828,62 @@ protected:
 typedef JSONRPCServer_<SimpleSessionStore> JSONRPCServer;
 
 
+template <typename SessionStoreType>
+const std::string JSONRPCServer_<SessionStoreType>::SUBSCRIBE_METHOD = "rpc.subscribe";
+
+
+template <typename SessionStoreType>
+const std::string JSONRPCServer_<SessionStoreType>::UNSUBSCRIBE_METHOD = "rpc.unsubscribe";
+
+
+template <typename SessionStoreType>
+const std::string JSONRPCServer_<SessionStoreType>::CANCEL_REQUEST_METHOD = "$/cancelRequest";
+
+
+template <typename SessionStoreType>
+const std::string JSONRPCServer_<SessionStoreType>::STATS_METHOD = "rpc.stats";
+
+
+template <typename SessionStoreType>
+const std::size_t JSONRPCServer_<SessionStoreType>::MAX_CANCELLED_CALL_IDS = 64;
+
+
 template <typename SessionStoreType>
 JSONRPCServer_<SessionStoreType>::JSONRPCServer_(const Settings& settings):
     BaseServer_<JSONRPCServerSettings, SessionStoreType>(settings),
+    _threadPool(new JSONRPC::ThreadPool(settings.numWorkerThreads)),
+    _numWorkerThreads(settings.numWorkerThreads),
     _fileSystemRoute(settings.fileSystemRouteSettings),
     _postRoute(settings.postRouteSettings),
-    _webSocketRoute(settings.webSocketRouteSettings)
+    _webSocketRoute(settings.webSocketRouteSettings),
+    _metricsRoute(settings.metricsRouteSettings),
+    _scheduler(new JSONRPC::Scheduler())
 {
     this->addRoute(&_fileSystemRoute); // #3 to test.
     this->addRoute(&_postRoute);       // #2 to test.
     this->addRoute(&_webSocketRoute);  // #1 to test.
 
+    if (settings.enableMetricsRoute)
+    {
+        this->addRoute(&_metricsRoute); // #0 to test.
+    }
+
+    _metricsRoute.setMetricsWriter([this](std::ostream& stream) {
+        writeMetrics(stream);
+    });
+
     _postRoute.registerPostEvents(this);
     _webSocketRoute.registerWebSocketEvents(this);
+
+    // Calls admitted from a concurrency queue run on the workers instead of
+    // delaying the thread that completed the previous call. The pool is
+    // only replaced while no calls are in progress.
+    this->setConcurrencyExecutor([this](std::function<void()> function) {
+        _threadPool->submit(function);
+    });
+
+    setupBuiltInMethods(settings);
+    this->setConcurrencyPolicy(settings.concurrencyPolicy);
 }
 
 
@@ -114,7 +892,16 @@ JSONRPCServer_<SessionStoreType>::~JSONRPCServer_()
 {
     _webSocketRoute.unregisterWebSocketEvents(this);
     _postRoute.unregisterPostEvents(this);
+    _metricsRoute.setMetricsWriter(nullptr);
+
+    // Queued main thread calls respond through this server, so they are
+    // discarded while it is still intact.
+    _mainThreadQueue.clear();
+
+    // Pending flushes also use this server.
+    _scheduler.reset();
 
+    this->removeRoute(&_metricsRoute);
     this->removeRoute(&_webSocketRoute);
     this->removeRoute(&_postRoute);
     this->removeRoute(&_fileSystemRoute);
@@ -124,153 +911,1175 @@ JSONRPCServer_<SessionStoreType>::~JSONRPCServer_()
 template <typename SessionStoreType>
 void JSONRPCServer_<SessionStoreType>::setup(const Settings& settings)
 {
+    setupBuiltInMethods(settings);
+    this->setConcurrencyPolicy(settings.concurrencyPolicy);
+
     BaseServer_<JSONRPCServerSettings, SessionStoreType>::setup(settings);
     _fileSystemRoute.setup(settings.fileSystemRouteSettings);
     _postRoute.setup(settings.postRouteSettings);
     _webSocketRoute.setup(settings.webSocketRouteSettings);
-}
+    _metricsRoute.setup(settings.metricsRouteSettings);
 
+    // The route is removed first so that it is never added twice.
+    this->removeRoute(&_metricsRoute);
 
-template <typename SessionStoreType>
-FileSystemRoute& JSONRPCServer_<SessionStoreType>::fileSystemRoute()
-{
-    return _fileSystemRoute;
+    if (settings.enableMetricsRoute)
+    {
+        this->addRoute(&_metricsRoute);
+    }
+
+    setupThreadPool();
 }
 
 
 template <typename SessionStoreType>
-PostRoute& JSONRPCServer_<SessionStoreType>::postRoute()
+void JSONRPCServer_<SessionStoreType>::start()
 {
-    return _postRoute;
+    setupThreadPool();
+    BaseServer_<JSONRPCServerSettings, SessionStoreType>::start();
 }
 
 
 template <typename SessionStoreType>
-WebSocketRoute& JSONRPCServer_<SessionStoreType>::webSocketRoute()
+void JSONRPCServer_<SessionStoreType>::setupThreadPool()
 {
-    return _webSocketRoute;
-}
+    if (_numWorkerThreads == this->_settings.numWorkerThreads)
+    {
+        return;
+    }
 
+    bool isIdle = !this->isRunning();
 
-template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onWebSocketOpenEvent(WebSocketOpenEventArgs& evt)
-{
-    return false;  // We did not attend to this event, so pass it along.
-}
+    if (isIdle)
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+        isIdle = _connections.empty();
+    }
 
+    if (!isIdle)
+    {
+        ofLogNotice("JSONRPCServer::setupThreadPool") << "The number of worker threads will change when the server is restarted.";
+        return;
+    }
 
-template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onWebSocketCloseEvent(WebSocketCloseEventArgs& evt)
-{
-    return false;  // We did not attend to this event, so pass it along.
+    // The previous pool completes the tasks already submitted to it before
+    // it is destroyed.
+    _threadPool.reset(new JSONRPC::ThreadPool(this->_settings.numWorkerThreads));
+    _numWorkerThreads = this->_settings.numWorkerThreads;
 }
 
 
 template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onWebSocketFrameReceivedEvent(WebSocketFrameEventArgs& evt)
+void JSONRPCServer_<SessionStoreType>::setupBuiltInMethods(const Settings& settings)
 {
-    try
+    if (settings.enableSubscriptions)
     {
-        ofJson json = ofJson::parse(evt.frame().getText());
-
-        try
-        {
-            JSONRPC::Request request = JSONRPC::Request::fromJSON(evt, json);
-            JSONRPC::Response response = processCall(this, request);
-
-            if (response.hasId())
-            {
-                evt.connection().sendFrame(response.toString());
-            }
-        }
-        catch (const Poco::InvalidArgumentException& exc)
-        {
-            JSONRPC::Response response(evt,
-                                       ofJson(nullptr), // null value is required when parse exceptions
-                                       JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INVALID_PARAMETERS));
-
-            evt.connection().sendFrame(response.toString());
-        }
-        catch (const Poco::Exception& exc)
-        {
-            JSONRPC::Response response(evt,
-                                       ofJson(nullptr), // null value is required when parse exceptions
-                                       JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INTERNAL_ERROR));
-
-            evt.connection().sendFrame(response.toString());
-        }
+        this->registerMethod(SUBSCRIBE_METHOD,
+                             "Subscribe to an array of topics.",
+                             this,
+                             &JSONRPCServer_::onSubscribe);
+
+        this->registerMethod(UNSUBSCRIBE_METHOD,
+                             "Unsubscribe from an array of topics.",
+                             this,
+                             &JSONRPCServer_::onUnsubscribe);
+    }
+    else
+    {
+        this->unregisterMethod(SUBSCRIBE_METHOD);
+        this->unregisterMethod(UNSUBSCRIBE_METHOD);
+    }
 
-        return true;  // We attended to the event, so consume it.
+    if (settings.enableCancellation)
+    {
+        this->registerMethod(CANCEL_REQUEST_METHOD,
+                             "Cancel the call with the given id.",
+                             this,
+                             &JSONRPCServer_::onCancelRequest);
+    }
+    else
+    {
+        this->unregisterMethod(CANCEL_REQUEST_METHOD);
+    }
 
+    if (settings.enableStats && settings.enableStatsMethod)
+    {
+        this->registerMethod(STATS_METHOD,
+                             "Get the call statistics of an array of methods, or of all methods.",
+                             this,
+                             &JSONRPCServer_::onStats);
     }
-    catch (const std::invalid_argument& exc)
+    else
     {
-        ofLogVerbose("JSONRPCServer::onWebSocketFrameReceivedEvent") << "Could not parse as JSON: " << exc.what();
-        ofLogVerbose("JSONRPCServer::onWebSocketFrameReceivedEvent") << evt.frame().getText();
-        return false;  // We did not attend to this event, so pass it along.
+        this->unregisterMethod(STATS_METHOD);
     }
+
+    this->setStatsEnabled(settings.enableStats);
 }
 
 
 template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onWebSocketFrameSentEvent(WebSocketFrameEventArgs& evt)
+FileSystemRoute& JSONRPCServer_<SessionStoreType>::fileSystemRoute()
 {
-    return false;  // We did not attend to this event, so pass it along.
+    return _fileSystemRoute;
 }
 
 
 template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onWebSocketErrorEvent(WebSocketErrorEventArgs& evt)
+PostRoute& JSONRPCServer_<SessionStoreType>::postRoute()
 {
-    return false;  // We did not attend to this event, so pass it along.
+    return _postRoute;
 }
 
 
 template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onHTTPFormEvent(PostFormEventArgs& args)
+WebSocketRoute& JSONRPCServer_<SessionStoreType>::webSocketRoute()
 {
-    ofLogVerbose("JSONRPCServer::onHTTPFormEvent") << "";
-    return false;  // We did not attend to this event, so pass it along.
+    return _webSocketRoute;
 }
 
 
 template <typename SessionStoreType>
-bool JSONRPCServer_<SessionStoreType>::onHTTPPostEvent(PostEventArgs& args)
+JSONRPC::ThreadPool& JSONRPCServer_<SessionStoreType>::threadPool()
 {
-    try
+    return *_threadPool;
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::sendFrame(const WebSocketConnection* connection,
+                                                 const WebSocketFrame& frame)
+{
+    SharedConnectionStatePtr state;
+
     {
-        ofJson json = ofJson::parse(args.getBuffer().getText());
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
 
-        try
-        {
-            JSONRPC::Request request = JSONRPC::Request::fromJSON(args, json);
-            JSONRPC::Response response = processCall(this, request);
+        auto iter = _connections.find(connection);
 
-            if (response.hasId())
-            {
-                std::string buffer = response.toString();
-                args.response().sendBuffer(buffer.c_str(), buffer.length());
-            }
-        }
-        catch (Poco::Exception& exc)
+        if (iter == _connections.end())
         {
-            JSONRPC::Response response(args,
-                                       ofJson(nullptr), // null value is required when parse exceptions.
-                                       JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_METHOD_NOT_FOUND));
-
-            std::string buffer = response.toString();
-            args.response().sendBuffer(buffer.c_str(), buffer.length());
+            return false;
         }
 
-        return true;  // We attended to the event, so consume it.
+        state = iter->second;
     }
-    catch (const std::invalid_argument& exc)
+
+    std::unique_lock<std::mutex> stateLock(state->mutex);
+    return writeFrame(*state, frame, true);
+}
+
+
+template <typename SessionStoreType>
+typename JSONRPCServer_<SessionStoreType>::SendQueueStats JSONRPCServer_<SessionStoreType>::sendQueueStats() const
+{
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+    SendQueueStats stats = _closedConnectionStats;
+
+    for (const auto& connection: _connections)
+    {
+        std::unique_lock<std::mutex> stateLock(connection.second->mutex);
+
+        stats += connection.second->stats;
+
+        if (connection.second->isCongested)
+        {
+            ++stats.numCongestedConnections;
+        }
+    }
+
+    return stats;
+}
+
+
+template <typename SessionStoreType>
+typename JSONRPCServer_<SessionStoreType>::SendQueueStats JSONRPCServer_<SessionStoreType>::sendQueueStats(const WebSocketConnection* connection) const
+{
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+    auto iter = _connections.find(connection);
+
+    if (iter == _connections.end())
+    {
+        return SendQueueStats();
+    }
+
+    std::unique_lock<std::mutex> stateLock(iter->second->mutex);
+
+    SendQueueStats stats = iter->second->stats;
+    stats.numCongestedConnections = iter->second->isCongested ? 1 : 0;
+    return stats;
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::writeMetrics(std::ostream& stream) const
+{
+    std::map<std::string, JSONRPC::MethodStats::Snapshot> methodStats = this->methodStats();
+
+    stream << "# TYPE jsonrpc_calls counter\n";
+    stream << "# HELP jsonrpc_calls Completed calls.\n";
+
+    for (const auto& entry: methodStats)
+    {
+        stream << "jsonrpc_calls_total{method=\"" << MetricsRoute::escapeLabelValue(entry.first) << "\"} " << entry.second.numCalls << "\n";
+    }
+
+    stream << "# TYPE jsonrpc_notifications counter\n";
+    stream << "# HELP jsonrpc_notifications Received notifications.\n";
+
+    for (const auto& entry: methodStats)
+    {
+        stream << "jsonrpc_notifications_total{method=\"" << MetricsRoute::escapeLabelValue(entry.first) << "\"} " << entry.second.numNotifications << "\n";
+    }
+
+    stream << "# TYPE jsonrpc_errors counter\n";
+    stream << "# HELP jsonrpc_errors Calls completed with an error.\n";
+
+    for (const auto& entry: methodStats)
+    {
+        for (const auto& error: entry.second.numErrorsByCode)
+        {
+            stream << "jsonrpc_errors_total{method=\"" << MetricsRoute::escapeLabelValue(entry.first) << "\",code=\"" << error.first << "\"} " << error.second << "\n";
+        }
+    }
+
+    stream << "# TYPE jsonrpc_active_calls gauge\n";
+    stream << "# HELP jsonrpc_active_calls Calls in progress.\n";
+
+    for (const auto& entry: methodStats)
+    {
+        stream << "jsonrpc_active_calls{method=\"" << MetricsRoute::escapeLabelValue(entry.first) << "\"} " << entry.second.numActiveCalls << "\n";
+    }
+
+    stream << "# TYPE jsonrpc_call_duration_seconds histogram\n";
+    stream << "# UNIT jsonrpc_call_duration_seconds seconds\n";
+    stream << "# HELP jsonrpc_call_duration_seconds Call latency by phase.\n";
+
+    for (const auto& entry: methodStats)
+    {
+        for (std::size_t i = 0; i < JSONRPC::MethodStats::NUM_PHASES; ++i)
+        {
+            std::string labels = "method=\"" + MetricsRoute::escapeLabelValue(entry.first) + "\",phase=\"" + JSONRPC::MethodStats::toString(JSONRPC::MethodStats::Phase(i)) + "\"";
+            writeHistogram(stream, "jsonrpc_call_duration_seconds", labels, entry.second.phases[i]);
+        }
+    }
+
+    JSONRPC::ConcurrencyLimiter::Stats concurrencyStats = this->concurrencyStats();
+
+    stream << "# TYPE jsonrpc_queued_calls gauge\n";
+    stream << "# HELP jsonrpc_queued_calls Calls waiting for the global concurrency limit.\n";
+    stream << "jsonrpc_queued_calls " << concurrencyStats.numQueuedCalls << "\n";
+
+    stream << "# TYPE jsonrpc_rejected_calls counter\n";
+    stream << "# HELP jsonrpc_rejected_calls Calls rejected by the global concurrency limit.\n";
+    stream << "jsonrpc_rejected_calls_total " << concurrencyStats.numRejected + concurrencyStats.numTimedOut << "\n";
+
+    std::size_t numConnections = 0;
+    std::size_t numQueuedFrames = 0;
+    std::size_t maxQueuedFrames = 0;
+
+    SendQueueStats sendStats;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+        sendStats = _closedConnectionStats;
+        numConnections = _connections.size();
+
+        for (const auto& connection: _connections)
+        {
+            std::size_t queueSize = connection.first->getSendQueueSize();
+            numQueuedFrames += queueSize;
+            maxQueuedFrames = std::max(maxQueuedFrames, queueSize);
+
+            std::unique_lock<std::mutex> stateLock(connection.second->mutex);
+
+            sendStats += connection.second->stats;
+
+            if (connection.second->isCongested)
+            {
+                ++sendStats.numCongestedConnections;
+            }
+        }
+    }
+
+    stream << "# TYPE jsonrpc_websocket_connections gauge\n";
+    stream << "# HELP jsonrpc_websocket_connections Open WebSocket connections.\n";
+    stream << "jsonrpc_websocket_connections " << numConnections << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_congested_connections gauge\n";
+    stream << "# HELP jsonrpc_websocket_congested_connections WebSocket connections above the send queue high water mark.\n";
+    stream << "jsonrpc_websocket_congested_connections " << sendStats.numCongestedConnections << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_send_queue_frames gauge\n";
+    stream << "# HELP jsonrpc_websocket_send_queue_frames Frames waiting to be sent on all WebSocket connections.\n";
+    stream << "jsonrpc_websocket_send_queue_frames " << numQueuedFrames << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_max_send_queue_frames gauge\n";
+    stream << "# HELP jsonrpc_websocket_max_send_queue_frames Frames waiting to be sent on the most congested WebSocket connection.\n";
+    stream << "jsonrpc_websocket_max_send_queue_frames " << maxQueuedFrames << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_sent_frames counter\n";
+    stream << "# HELP jsonrpc_websocket_sent_frames Frames sent to WebSocket connections.\n";
+    stream << "jsonrpc_websocket_sent_frames_total " << sendStats.numFramesSent << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_sent_bytes counter\n";
+    stream << "# UNIT jsonrpc_websocket_sent_bytes bytes\n";
+    stream << "# HELP jsonrpc_websocket_sent_bytes Payload bytes sent to WebSocket connections.\n";
+    stream << "jsonrpc_websocket_sent_bytes_total " << sendStats.numBytesSent << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_dropped_frames counter\n";
+    stream << "# HELP jsonrpc_websocket_dropped_frames Frames dropped because a WebSocket connection was congested.\n";
+    stream << "jsonrpc_websocket_dropped_frames_total " << sendStats.numFramesDropped << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_congestion_events counter\n";
+    stream << "# HELP jsonrpc_websocket_congestion_events Times a WebSocket connection became congested.\n";
+    stream << "jsonrpc_websocket_congestion_events_total " << sendStats.numCongestionEvents << "\n";
+
+    stream << "# TYPE jsonrpc_websocket_closed_connections counter\n";
+    stream << "# HELP jsonrpc_websocket_closed_connections WebSocket connections closed because they were congested.\n";
+    stream << "jsonrpc_websocket_closed_connections_total " << sendStats.numConnectionsClosed << "\n";
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::writeHistogram(std::ostream& stream,
+                                                      const std::string& name,
+                                                      const std::string& labels,
+                                                      const JSONRPC::LatencyHistogram::Snapshot& snapshot)
+{
+    // The upper bounds in microseconds and as they are written.
+    static const std::pair<uint64_t, const char*> BOUNDS[] = {
+        { 100, "0.0001" },
+        { 250, "0.00025" },
+        { 500, "0.0005" },
+        { 1000, "0.001" },
+        { 2500, "0.0025" },
+        { 5000, "0.005" },
+        { 10000, "0.01" },
+        { 25000, "0.025" },
+        { 50000, "0.05" },
+        { 100000, "0.1" },
+        { 250000, "0.25" },
+        { 500000, "0.5" },
+        { 1000000, "1.0" },
+        { 2500000, "2.5" },
+        { 5000000, "5.0" },
+        { 10000000, "10.0" }
+    };
+
+    uint64_t count = 0;
+    std::size_t index = 0;
+
+    for (const auto& bound: BOUNDS)
+    {
+        // A fine bucket is counted once all of its values are within the
+        // bound, so counts may lag a bound by the width of a fine bucket.
+        while (index < snapshot.counts.size() && JSONRPC::LatencyHistogram::bucketUpperBound(index) <= bound.first)
+        {
+            count += snapshot.counts[index++];
+        }
+
+        stream << name << "_bucket{" << labels << ",le=\"" << bound.second << "\"} " << count << "\n";
+    }
+
+    stream << name << "_bucket{" << labels << ",le=\"+Inf\"} " << snapshot.count << "\n";
+    stream << name << "_count{" << labels << "} " << snapshot.count << "\n";
+    // The sum is written with a fixed microsecond resolution.
+    std::ostringstream sum;
+    sum << std::fixed << std::setprecision(6) << snapshot.sum / 1000000.0;
+
+    stream << name << "_sum{" << labels << "} " << sum.str() << "\n";
+}
+
+
+template <typename SessionStoreType>
+std::size_t JSONRPCServer_<SessionStoreType>::broadcastNotification(const std::string& method,
+                                                                    const ofJson& params,
+                                                                    ConnectionFilter filter)
+{
+    ofJson json = JSONRPC::Request::notificationToJSON(method, params);
+
+    std::vector<SharedConnectionStatePtr> connectionStates;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+        connectionStates.reserve(_connections.size());
+
+        for (const auto& connection: _connections)
+        {
+            if (!filter || filter(*connection.first))
+            {
+                connectionStates.push_back(connection.second);
+            }
+        }
+    }
+
+    NotificationFrames frames;
+
+    std::size_t numSent = 0;
+
+    for (const auto& connectionState: connectionStates)
+    {
+        std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+        if (sendNotification(*connectionState, json, frames))
+        {
+            ++numSent;
+        }
+    }
+
+    return numSent;
+}
+
+
+template <typename SessionStoreType>
+std::size_t JSONRPCServer_<SessionStoreType>::publish(const std::string& topic,
+                                                      const ofJson& params)
+{
+    ofJson json = JSONRPC::Request::notificationToJSON(topic, params);
+
+    std::vector<SharedConnectionStatePtr> connectionStates;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+        auto subscribersIter = _subscribers.find(topic);
+
+        if (subscribersIter == _subscribers.end())
+        {
+            return 0;
+        }
+
+        connectionStates.reserve(subscribersIter->second.size());
+
+        for (const WebSocketConnection* connection: subscribersIter->second)
+        {
+            auto connectionIter = _connections.find(connection);
+
+            if (connectionIter != _connections.end())
+            {
+                connectionStates.push_back(connectionIter->second);
+            }
+        }
+    }
+
+    NotificationFrames frames;
+
+    std::size_t numSent = 0;
+
+    for (const auto& connectionState: connectionStates)
+    {
+        std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+        if (sendNotification(*connectionState, json, frames))
+        {
+            ++numSent;
+        }
+    }
+
+    return numSent;
+}
+
+
+template <typename SessionStoreType>
+std::size_t JSONRPCServer_<SessionStoreType>::numSubscribers(const std::string& topic) const
+{
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+    auto iter = _subscribers.find(topic);
+
+    return iter != _subscribers.end() ? iter->second.size() : 0;
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::onSubscribe(const void*,
+                                                   JSONRPC::MethodArgs& args)
+{
+    std::vector<std::string> topics = topicsFromArgs(args);
+
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+    SharedConnectionStatePtr state = findConnectionState(args);
+
+    std::size_t maxTopics = this->_settings.maxTopicsPerConnection;
+
+    if (maxTopics > 0)
+    {
+        std::set<std::string> newTopics;
+
+        for (const auto& topic: topics)
+        {
+            if (state->topics.find(topic) == state->topics.end())
+            {
+                newTopics.insert(topic);
+            }
+        }
+
+        if (state->topics.size() + newTopics.size() > maxTopics)
+        {
+            throw JSONRPC::InvalidParametersException("A connection may subscribe to at most " + std::to_string(maxTopics) + " topics.");
+        }
+    }
+
+    for (const auto& topic: topics)
+    {
+        state->topics.insert(topic);
+        _subscribers[topic].insert(state->connection);
+    }
+
+    args.result = state->topics;
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::onUnsubscribe(const void*,
+                                                     JSONRPC::MethodArgs& args)
+{
+    std::vector<std::string> topics = topicsFromArgs(args);
+
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+    SharedConnectionStatePtr state = findConnectionState(args);
+
+    for (const auto& topic: topics)
+    {
+        state->topics.erase(topic);
+
+        auto subscribersIter = _subscribers.find(topic);
+
+        if (subscribersIter != _subscribers.end())
+        {
+            subscribersIter->second.erase(state->connection);
+
+            if (subscribersIter->second.empty())
+            {
+                _subscribers.erase(subscribersIter);
+            }
+        }
+    }
+
+    args.result = state->topics;
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::onCancelRequest(const void* pSender,
+                                                       JSONRPC::MethodArgs& args)
+{
+    if (!args.params.is_object() || args.params.find("id") == args.params.end())
+    {
+        throw JSONRPC::InvalidParametersException("Expected the id of the call to cancel.");
+    }
+
+    SharedConnectionStatePtr connectionState;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+        connectionState = findConnectionState(args);
+    }
+
+    JSONRPC::CancellationToken cancellationToken;
+
+    {
+        std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+        ConnectionState& state = *connectionState;
+
+        std::string callId = args.params["id"].dump();
+
+        auto callIter = state.activeCalls.find(callId);
+
+        if (callIter != state.activeCalls.end())
+        {
+            cancellationToken = callIter->second;
+        }
+        else if (state.taskQueue && state.taskQueue->numQueuedTasks() > 0)
+        {
+            // Cancel requests skip the frame queue, so the call may still be
+            // waiting in it. It is cancelled as soon as it starts, unless a
+            // frame received after this request starts first.
+            state.cancelledCallIds.push_back(std::make_pair(callId, state.numFramesQueued));
+
+            if (state.cancelledCallIds.size() > MAX_CANCELLED_CALL_IDS)
+            {
+                state.cancelledCallIds.pop_front();
+            }
+
+            args.result = true;
+            return;
+        }
+    }
+
+    // The call's response is sent while it is cancelled, so the token must
+    // not be cancelled while holding the state's mutex.
+    args.result = cancellationToken.cancel();
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::onStats(JSONRPC::MethodArgs& args)
+{
+    if (!args.params.is_null() && !args.params.is_array())
+    {
+        throw JSONRPC::InvalidParametersException("Expected an array of method names.");
+    }
+
+    ofJson result = ofJson::object();
+
+    if (args.params.is_null() || args.params.empty())
+    {
+        for (const auto& entry: this->methodStats())
+        {
+            result[entry.first] = JSONRPC::MethodStats::Snapshot::toJSON(entry.second);
+        }
+    }
+    else
+    {
+        for (const auto& method: args.params)
+        {
+            if (!method.is_string())
+            {
+                throw JSONRPC::InvalidParametersException("Expected an array of method names.");
+            }
+
+            if (this->hasMethod(method))
+            {
+                result[method.get<std::string>()] = JSONRPC::MethodStats::Snapshot::toJSON(this->methodStats(method.get<std::string>()));
+            }
+        }
+    }
+
+    args.result = result;
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::sendNotification(ConnectionState& state,
+                                                        const ofJson& json,
+                                                        NotificationFrames& frames)
+{
+    if (!state.isOpen)
+    {
+        return false;
+    }
+
+    std::size_t maxQueueSize = this->_settings.maxBroadcastSendQueueSize;
+
+    if (maxQueueSize > 0 && state.connection->getSendQueueSize() > maxQueueSize)
+    {
+        ofLogVerbose("JSONRPCServer::sendNotification") << "Skipped slow connection.";
+        ++state.stats.numFramesDropped;
+        return false;
+    }
+
+    std::unique_ptr<WebSocketFrame>& frame = frames[static_cast<std::size_t>(state.binaryEncoding)];
+
+    // Each frame is serialized once for all connections that use its
+    // encoding. Sending it copies it into the connection's send queue.
+    if (!frame)
+    {
+        std::string buffer;
+        JSONRPC::JSONRPCUtils::write(json, state.binaryEncoding, buffer);
+
+        int flags = state.binaryEncoding == JSONRPC::Encoding::JSON ? Poco::Net::WebSocket::FRAME_TEXT : Poco::Net::WebSocket::FRAME_BINARY;
+
+        frame.reset(new WebSocketFrame(buffer, flags));
+    }
+
+    return writeFrame(state, *frame, true);
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::sendResponse(const SharedConnectionStatePtr& connectionState,
+                                                    std::string& buffer,
+                                                    bool isBinary,
+                                                    bool isBatch)
+{
+    int flags = isBinary ? Poco::Net::WebSocket::FRAME_BINARY : Poco::Net::WebSocket::FRAME_TEXT;
+
+    uint64_t delay = this->_settings.responseCoalescingDelay;
+
+    std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+    ConnectionState& state = *connectionState;
+
+    if (!state.isOpen)
+    {
+        return false;
+    }
+
+    std::vector<std::string>& responses = state.coalescedResponses[isBinary ? 1 : 0];
+
+    // Batch responses are already arrays and cannot be nested, so they are
+    // sent on their own after the responses that completed before them.
+    if (delay == 0 || isBatch || !state.isCoalescing)
+    {
+        if (!responses.empty())
+        {
+            flushResponses(state);
+        }
+
+        return writeFrame(state, WebSocketFrame(buffer, flags), false);
+    }
+
+    responses.push_back(std::move(buffer));
+
+    if (responses.size() >= std::max(std::size_t(1), this->_settings.maxCoalescedResponses))
+    {
+        flushResponses(state);
+    }
+    else if (!state.isFlushScheduled)
+    {
+        state.isFlushScheduled = true;
+
+        // The flush must not keep a closed connection's state alive.
+        std::weak_ptr<ConnectionState> weakState = connectionState;
+
+        _scheduler->schedule(std::chrono::microseconds(delay), [this, weakState]() {
+            SharedConnectionStatePtr state = weakState.lock();
+
+            if (state)
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                flushResponses(*state);
+            }
+        });
+    }
+
+    return true;
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::flushResponses(ConnectionState& state)
+{
+    state.isFlushScheduled = false;
+
+    for (std::size_t i = 0; i < state.coalescedResponses.size(); ++i)
+    {
+        std::vector<std::string>& responses = state.coalescedResponses[i];
+
+        if (responses.empty())
+        {
+            continue;
+        }
+
+        bool isBinary = i == 1;
+
+        int flags = isBinary ? Poco::Net::WebSocket::FRAME_BINARY : Poco::Net::WebSocket::FRAME_TEXT;
+
+        if (responses.size() == 1)
+        {
+            writeFrame(state, WebSocketFrame(responses.front(), flags), false);
+        }
+        else
+        {
+            JSONRPC::Encoding encoding = isBinary ? state.binaryEncoding : JSONRPC::Encoding::JSON;
+
+            std::string buffer;
+
+            if (encoding == JSONRPC::Encoding::JSON)
+            {
+                buffer.push_back('[');
+
+                for (const auto& response: responses)
+                {
+                    if (buffer.size() > 1)
+                    {
+                        buffer.push_back(',');
+                    }
+
+                    buffer.append(response);
+                }
+
+                buffer.push_back(']');
+            }
+            else
+            {
+                JSONRPC::JSONRPCUtils::writeArrayHeader(responses.size(), encoding, buffer);
+
+                for (const auto& response: responses)
+                {
+                    buffer.append(response);
+                }
+            }
+
+            writeFrame(state, WebSocketFrame(buffer, flags), false);
+        }
+
+        responses.clear();
+    }
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::writeFrame(ConnectionState& state,
+                                                  const WebSocketFrame& frame,
+                                                  bool isDroppable)
+{
+    // The connection may have closed while the frame was prepared.
+    if (!state.isOpen)
+    {
+        return false;
+    }
+
+    WebSocketConnection* connection = state.connection;
+
+    std::size_t highWaterMark = this->_settings.sendQueueHighWaterMark;
+
+    if (highWaterMark > 0 && !state.isClosing)
+    {
+        std::size_t queueSize = connection->getSendQueueSize();
+
+        if (state.isCongested)
+        {
+            state.isCongested = queueSize > std::min(this->_settings.sendQueueLowWaterMark, highWaterMark);
+        }
+        else if (queueSize >= highWaterMark)
+        {
+            state.isCongested = true;
+            ++state.stats.numCongestionEvents;
+
+            ofLogWarning("JSONRPCServer::writeFrame") << "Connection is congested with " << queueSize << " queued frames.";
+
+            if (this->_settings.backpressurePolicy == BackpressurePolicy::CLOSE)
+            {
+                // A close frame would wait behind the backlog, so the
+                // connection is shut down instead. This only signals the
+                // connection, which reports the close event later.
+                connection->close();
+
+                state.isClosing = true;
+                ++state.stats.numConnectionsClosed;
+            }
+        }
+    }
+
+    if (state.isClosing || (state.isCongested && isDroppable) || !connection->sendFrame(frame))
+    {
+        ++state.stats.numFramesDropped;
+        return false;
+    }
+
+    ++state.stats.numFramesSent;
+    state.stats.numBytesSent += frame.size();
+    return true;
+}
+
+
+template <typename SessionStoreType>
+typename JSONRPCServer_<SessionStoreType>::SharedConnectionStatePtr JSONRPCServer_<SessionStoreType>::findConnectionState(const JSONRPC::MethodArgs& args) const
+{
+    if (!args.connection)
+    {
+        throw JSONRPC::InvalidRequestException("This method requires a WebSocket connection.");
+    }
+
+    auto iter = _connections.find(args.connection);
+
+    // A later connection may have reused the address of the calling one.
+    if (iter == _connections.end() || iter->second->id != args.connectionId)
+    {
+        throw JSONRPC::InvalidRequestException("The WebSocket connection has closed.");
+    }
+
+    return iter->second;
+}
+
+
+template <typename SessionStoreType>
+std::vector<std::string> JSONRPCServer_<SessionStoreType>::topicsFromArgs(const JSONRPC::MethodArgs& args)
+{
+    if (!args.params.is_array())
+    {
+        throw JSONRPC::InvalidParametersException("Expected an array of topics.");
+    }
+
+    std::vector<std::string> topics;
+
+    for (const auto& topic: args.params)
+    {
+        if (!topic.is_string())
+        {
+            throw JSONRPC::InvalidParametersException("Topics must be strings.");
+        }
+
+        topics.push_back(topic.template get<std::string>());
+    }
+
+    return topics;
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onWebSocketOpenEvent(WebSocketOpenEventArgs& evt)
+{
+    // A new state is created for every connection, so work in progress for
+    // a closed connection never reaches a later one at the same address.
+    SharedConnectionStatePtr state = std::make_shared<ConnectionState>();
+    state->connection = &evt.connection();
+
+    std::string subprotocols = evt.request().get("Sec-WebSocket-Protocol", "");
+
+    // Binary frames are JSON text unless the client asked for a binary
+    // encoding. This is the subprotocol confirmed by the route.
+    state->binaryEncoding = JSONRPC::JSONRPCUtils::encodingForSubprotocols(subprotocols);
+    state->isCoalescing = JSONRPC::JSONRPCUtils::isCoalescingSubprotocol(subprotocols);
+
+    if (this->_settings.processFramesInBackground)
+    {
+        state->taskQueue = std::make_shared<JSONRPC::TaskQueue>(*_threadPool,
+                                                                this->_settings.preserveFrameOrder ? 1 : 0);
+    }
+
+    std::unique_lock<std::mutex> lock(_connectionsMutex);
+    state->id = ++_lastConnectionId;
+    _connections[&evt.connection()] = state;
+    return false;  // We did not attend to this event, so pass it along.
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onWebSocketCloseEvent(WebSocketCloseEventArgs& evt)
+{
+    std::shared_ptr<JSONRPC::TaskQueue> taskQueue;
+
+    std::unordered_map<std::string, JSONRPC::CancellationToken> activeCalls;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+        auto iter = _connections.find(&evt.connection());
+
+        if (iter != _connections.end())
+        {
+            ConnectionState& state = *iter->second;
+
+            {
+                // Work still in progress holds the state, but must not use
+                // the connection anymore.
+                std::unique_lock<std::mutex> stateLock(state.mutex);
+
+                state.isOpen = false;
+                taskQueue.swap(state.taskQueue);
+                activeCalls.swap(state.activeCalls);
+                state.coalescedResponses = {};
+                _closedConnectionStats += state.stats;
+            }
+
+            for (const auto& topic: state.topics)
+            {
+                auto subscribersIter = _subscribers.find(topic);
+
+                if (subscribersIter != _subscribers.end())
+                {
+                    subscribersIter->second.erase(iter->first);
+
+                    if (subscribersIter->second.empty())
+                    {
+                        _subscribers.erase(subscribersIter);
+                    }
+                }
+            }
+
+            _connections.erase(iter);
+        }
+    }
+
+    // Nobody is waiting for the results of the calls in progress anymore.
+    for (const auto& call: activeCalls)
+    {
+        call.second.cancel();
+    }
+
+    // Frames that have not started are dropped. Frames in progress must
+    // finish before the connection's event arguments are destroyed. Their
+    // responses are discarded because the connection is no longer open.
+    if (taskQueue)
+    {
+        taskQueue->close();
+    }
+
+    return false;  // We did not attend to this event, so pass it along.
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onWebSocketFrameReceivedEvent(WebSocketFrameEventArgs& evt)
+{
+    // Frames may wait in the connection's queue, which is part of the queue
+    // phase of their calls.
+    JSONRPC::MethodStats::Clock::time_point receivedTime = this->isStatsEnabled() ? JSONRPC::MethodStats::Clock::now() : JSONRPC::MethodStats::Clock::time_point();
+
+    const WebSocketConnection* connection = &evt.connection();
+
+    bool isBinary = (evt.frame().flags() & Poco::Net::WebSocket::FRAME_OP_BITMASK) == Poco::Net::WebSocket::FRAME_OP_BINARY;
+
+    JSONRPC::Encoding binaryEncoding = JSONRPC::Encoding::JSON;
+    std::shared_ptr<JSONRPC::TaskQueue> taskQueue;
+    SharedConnectionStatePtr connectionState;
+    uint64_t frameIndex = 0;
+
+    {
+        std::unique_lock<std::mutex> lock(_connectionsMutex);
+
+        auto iter = _connections.find(connection);
+
+        if (iter != _connections.end())
+        {
+            connectionState = iter->second;
+        }
+    }
+
+    if (connectionState)
+    {
+        std::unique_lock<std::mutex> lock(connectionState->mutex);
+        binaryEncoding = connectionState->binaryEncoding;
+        taskQueue = connectionState->taskQueue;
+
+        if (taskQueue)
+        {
+            frameIndex = connectionState->numFramesQueued++;
+        }
+    }
+
+    JSONRPC::Encoding encoding = isBinary ? binaryEncoding : JSONRPC::Encoding::JSON;
+
+    bool isCancellable = this->_settings.enableCancellation;
+
+    // Cancel requests must not wait behind the calls they cancel. The method
+    // name appears verbatim in every encoding, so only frames that mention
+    // it are parsed here to find out whether they are a cancel request.
+    const char* data = evt.frame().getData();
+    const char* dataEnd = data + evt.frame().size();
+
+    if (taskQueue && isCancellable && std::search(data, dataEnd, CANCEL_REQUEST_METHOD.begin(), CANCEL_REQUEST_METHOD.end()) != dataEnd)
+    {
+        std::shared_ptr<ofJson> json = std::make_shared<ofJson>();
+        JSONRPC::MethodStats::Clock::duration parseTime;
+
+        if (!parseFrame(evt.frame(), encoding, *json, parseTime))
+        {
+            return false;
+        }
+
+        if (json->is_object() && json->value("method", ofJson()) == CANCEL_REQUEST_METHOD)
+        {
+            processParsedFrame(evt, connectionState, std::move(*json), isBinary, encoding, parseTime, receivedTime);
+            return true;  // We attended to the event, so consume it.
+        }
+
+        // Other frames keep their place in the queue.
+        ServerEventArgs serverEvt(evt);
+
+        taskQueue->submit([this, serverEvt, connectionState, json, isBinary, encoding, parseTime, receivedTime, frameIndex]() mutable {
+            startQueuedFrame(*connectionState, frameIndex);
+            processParsedFrame(serverEvt, connectionState, std::move(*json), isBinary, encoding, parseTime, receivedTime);
+        });
+
+        return true;  // We attended to the event, so consume it.
+    }
+
+    if (taskQueue)
+    {
+        // The frame is owned by the event, so the queued task needs a copy.
+        ServerEventArgs serverEvt(evt);
+        std::shared_ptr<WebSocketFrame> frame = std::make_shared<WebSocketFrame>(evt.frame());
+
+        taskQueue->submit([this, serverEvt, connectionState, frame, encoding, receivedTime, isCancellable, frameIndex]() mutable {
+            if (isCancellable)
+            {
+                startQueuedFrame(*connectionState, frameIndex);
+            }
+
+            processFrame(serverEvt, connectionState, *frame, encoding, receivedTime);
+        });
+
+        return true;  // We attended to the event, so consume it.
+    }
+
+    return processFrame(evt, connectionState, evt.frame(), encoding, receivedTime);
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onWebSocketFrameSentEvent(WebSocketFrameEventArgs& evt)
+{
+    return false;  // We did not attend to this event, so pass it along.
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onWebSocketErrorEvent(WebSocketErrorEventArgs& evt)
+{
+    return false;  // We did not attend to this event, so pass it along.
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onHTTPFormEvent(PostFormEventArgs& args)
+{
+    ofLogVerbose("JSONRPCServer::onHTTPFormEvent") << "";
+    return false;  // We did not attend to this event, so pass it along.
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::onHTTPPostEvent(PostEventArgs& args)
+{
+    bool isTimed = this->isStatsEnabled();
+
+    JSONRPC::MethodStats::Clock::time_point parseStartTime = isTimed ? JSONRPC::MethodStats::Clock::now() : JSONRPC::MethodStats::Clock::time_point();
+
+    ofJson json;
+
+    try
+    {
+        json = JSONRPC::JSONRPCUtils::parse(args.getBuffer());
+    }
+    catch (const std::exception& exc)
     {
         ofLogVerbose("JSONRPCServer::onHTTPPostEvent") << "Could not parse as JSON: " << exc.what();
         ofLogVerbose("JSONRPCServer::onHTTPPostEvent") << args.getBuffer().getText();
 
-        return false;  // We did not attend to this event, so pass it along.
+        JSONRPC::Response response(args,
+                                   ofJson(nullptr), // null value is required when parse exceptions
+                                   JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_PARSE));
+        std::string buffer;
+        response.write(buffer, JSONRPC::Encoding::JSON);
+        args.response().sendBuffer(buffer.c_str(), buffer.length());
+
+        return true;  // We answered with a parse error, so consume it.
+    }
+
+    JSONRPC::MethodStats::Clock::duration parseTime = isTimed ? JSONRPC::MethodStats::Clock::now() - parseStartTime : JSONRPC::MethodStats::Clock::duration::zero();
+
+    // The response must be sent before this event returns, so wait for
+    // any deferred methods to complete.
+    std::promise<std::string> promise;
+    std::future<std::string> future = promise.get_future();
+
+    processMessage(this, args, std::move(json), JSONRPC::Encoding::JSON, [&promise](std::string& buffer) {
+        promise.set_value(std::move(buffer));
+    },
+    parseTime,
+    nullptr,
+    parseStartTime);
+
+    std::string buffer = future.get();
+
+    if (!buffer.empty())
+    {
+        args.response().sendBuffer(buffer.c_str(), buffer.length());
     }
+
+    return true;  // We attended to the event, so consume it.
 }
 
 
@@ -297,5 +2106,396 @@ bool JSONRPCServer_<SessionStoreType>::onHTTPUploadEvent(PostUploadEventArgs& ar
 
 
 
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::processFrame(ServerEventArgs& evt,
+                                                    SharedConnectionStatePtr connectionState,
+                                                    const WebSocketFrame& frame,
+                                                    JSONRPC::Encoding encoding,
+                                                    JSONRPC::MethodStats::Clock::time_point receivedTime)
+{
+    ofJson json;
+    JSONRPC::MethodStats::Clock::duration parseTime;
+
+    if (!parseFrame(frame, encoding, json, parseTime))
+    {
+        return false;
+    }
+
+    bool isBinary = (frame.flags() & Poco::Net::WebSocket::FRAME_OP_BITMASK) == Poco::Net::WebSocket::FRAME_OP_BINARY;
+
+    processParsedFrame(evt, connectionState, std::move(json), isBinary, encoding, parseTime, receivedTime);
+
+    return true;
+}
+
+
+template <typename SessionStoreType>
+bool JSONRPCServer_<SessionStoreType>::parseFrame(const WebSocketFrame& frame,
+                                                  JSONRPC::Encoding encoding,
+                                                  ofJson& json,
+                                                  JSONRPC::MethodStats::Clock::duration& parseTime)
+{
+    try
+    {
+        bool isTimed = this->isStatsEnabled();
+
+        JSONRPC::MethodStats::Clock::time_point parseStartTime = isTimed ? JSONRPC::MethodStats::Clock::now() : JSONRPC::MethodStats::Clock::time_point();
+
+        json = JSONRPC::JSONRPCUtils::parse(frame, encoding);
+
+        parseTime = isTimed ? JSONRPC::MethodStats::Clock::now() - parseStartTime : JSONRPC::MethodStats::Clock::duration::zero();
+
+        return true;
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogVerbose("JSONRPCServer::parseFrame") << "Could not parse frame: " << exc.what();
+
+        if ((frame.flags() & Poco::Net::WebSocket::FRAME_OP_BITMASK) != Poco::Net::WebSocket::FRAME_OP_BINARY)
+        {
+            ofLogVerbose("JSONRPCServer::parseFrame") << frame.getText();
+        }
+
+        return false;
+    }
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::processParsedFrame(ServerEventArgs& evt,
+                                                          SharedConnectionStatePtr connectionState,
+                                                          ofJson&& json,
+                                                          bool isBinary,
+                                                          JSONRPC::Encoding encoding,
+                                                          JSONRPC::MethodStats::Clock::duration parseTime,
+                                                          JSONRPC::MethodStats::Clock::time_point receivedTime)
+{
+    bool isBatch = json.is_array();
+
+    // The response may be sent later from another thread, so the
+    // connection is only used if it is still open. Responses are sent
+    // in the same kind of frame as the request.
+    processMessage(this, evt, std::move(json), encoding, [this, connectionState, isBinary, isBatch](std::string& buffer) {
+        if (!buffer.empty() && connectionState)
+        {
+            sendResponse(connectionState, buffer, isBinary, isBatch);
+        }
+    },
+    parseTime,
+    connectionState,
+    receivedTime);
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::startQueuedFrame(ConnectionState& connectionState,
+                                                        uint64_t frameIndex)
+{
+    std::unique_lock<std::mutex> lock(connectionState.mutex);
+
+    std::deque<std::pair<std::string, uint64_t>>& cancelledCallIds = connectionState.cancelledCallIds;
+
+    // Ids cancelled before this frame was received were meant for calls in
+    // earlier frames.
+    cancelledCallIds.erase(std::remove_if(cancelledCallIds.begin(), cancelledCallIds.end(), [frameIndex](const std::pair<std::string, uint64_t>& cancelledCall) {
+        return cancelledCall.second <= frameIndex;
+    }),
+    cancelledCallIds.end());
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::processMessage(const void* pSender,
+                                                      ServerEventArgs& evt,
+                                                      ofJson&& json,
+                                                      JSONRPC::Encoding encoding,
+                                                      ResponseBufferHandler responseHandler,
+                                                      JSONRPC::MethodStats::Clock::duration parseTime,
+                                                      SharedConnectionStatePtr connectionState,
+                                                      JSONRPC::MethodStats::Clock::time_point receivedTime)
+{
+    if (json.is_array())
+    {
+        if (json.empty())
+        {
+            JSONRPC::Response response(evt,
+                                       ofJson(nullptr), // null value is required for invalid requests.
+                                       JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INVALID_REQUEST));
+            std::string buffer;
+            response.write(buffer, encoding);
+            responseHandler(buffer);
+        }
+        else
+        {
+            processBatch(pSender, evt, std::move(json), encoding, responseHandler, parseTime, connectionState, receivedTime);
+        }
+    }
+    else
+    {
+        processRequest(pSender, evt, std::move(json), encoding, responseHandler, parseTime, connectionState, receivedTime);
+    }
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::processRequest(const void* pSender,
+                                                      ServerEventArgs& evt,
+                                                      ofJson&& json,
+                                                      JSONRPC::Encoding encoding,
+                                                      ResponseBufferHandler responseHandler,
+                                                      JSONRPC::MethodStats::Clock::duration parseTime,
+                                                      SharedConnectionStatePtr connectionState,
+                                                      JSONRPC::MethodStats::Clock::time_point receivedTime)
+{
+    std::string buffer;
+
+    try
+    {
+        bool isTimed = this->isStatsEnabled();
+
+        JSONRPC::MethodStats::Clock::time_point parseStartTime = isTimed ? JSONRPC::MethodStats::Clock::now() : JSONRPC::MethodStats::Clock::time_point();
+
+        JSONRPC::Request request = JSONRPC::Request::fromJSON(evt, std::move(json));
+
+        if (connectionState)
+        {
+            // The id and connection never change, so they are read without
+            // locking the state.
+            request.setConnection(connectionState->connection, connectionState->id);
+        }
+
+        std::shared_ptr<JSONRPC::MethodStats> stats = isTimed ? this->sharedMethodStats(request.method()) : nullptr;
+
+        if (stats)
+        {
+            JSONRPC::MethodStats::Clock::duration requestParseTime = parseTime + (JSONRPC::MethodStats::Clock::now() - parseStartTime);
+
+            stats->record(JSONRPC::MethodStats::Phase::PARSE, requestParseTime);
+
+            // The queue phase covers the rest of the time until the method
+            // is invoked.
+            if (receivedTime != JSONRPC::MethodStats::Clock::time_point())
+            {
+                request.setReceivedTime(receivedTime + requestParseTime);
+            }
+        }
+
+        if (request.isNotification())
+        {
+            if (this->_settings.processNotificationsInBackground)
+            {
+                processNotification(pSender, request, *_threadPool);
+            }
+            else
+            {
+                processNotification(pSender, request);
+            }
+
+            responseHandler(buffer);
+            return;
+        }
+
+        JSONRPC::CancellationToken cancellationToken;
+
+        std::string callId;
+
+        if (connectionState && this->_settings.enableCancellation)
+        {
+            std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+            // Calls on a WebSocket connection can be cancelled by the client
+            // until they complete.
+            if (connectionState->isOpen)
+            {
+                callId = request.id().dump();
+                cancellationToken = JSONRPC::CancellationToken::create();
+                connectionState->activeCalls[callId] = cancellationToken;
+
+                std::deque<std::pair<std::string, uint64_t>>& cancelledCallIds = connectionState->cancelledCallIds;
+
+                auto cancelledIter = std::find_if(cancelledCallIds.begin(), cancelledCallIds.end(), [&callId](const std::pair<std::string, uint64_t>& cancelledCall) {
+                    return cancelledCall.first == callId;
+                });
+
+                if (cancelledIter != cancelledCallIds.end())
+                {
+                    cancelledCallIds.erase(cancelledIter);
+                    cancellationToken.cancel();
+                }
+            }
+        }
+
+        if (this->_settings.callTimeout > 0)
+        {
+            cancellationToken.setDeadline(JSONRPC::CancellationToken::Clock::now() + std::chrono::milliseconds(this->_settings.callTimeout));
+        }
+
+        processCall(pSender, request, [connectionState, callId, cancellationToken, encoding, responseHandler, stats](JSONRPC::Response& response) {
+            if (connectionState && !callId.empty())
+            {
+                std::unique_lock<std::mutex> lock(connectionState->mutex);
+
+                auto callIter = connectionState->activeCalls.find(callId);
+
+                // A later call may have reused the id.
+                if (callIter != connectionState->activeCalls.end() && callIter->second == cancellationToken)
+                {
+                    connectionState->activeCalls.erase(callIter);
+                }
+            }
+
+            std::string buffer;
+
+            JSONRPC::MethodStats::Clock::time_point serializeStartTime = stats ? JSONRPC::MethodStats::Clock::now() : JSONRPC::MethodStats::Clock::time_point();
+
+            if (response.hasId())
+            {
+                // Serialize straight into the buffer that will be sent.
+                response.write(buffer, encoding);
+            }
+
+            if (!stats)
+            {
+                responseHandler(buffer);
+                return;
+            }
+
+            JSONRPC::MethodStats::Clock::time_point sendStartTime = JSONRPC::MethodStats::Clock::now();
+
+            stats->record(JSONRPC::MethodStats::Phase::SERIALIZE, sendStartTime - serializeStartTime);
+
+            // For batches, the last element to complete also sends the
+            // batch response.
+            responseHandler(buffer);
+
+            stats->record(JSONRPC::MethodStats::Phase::SEND, JSONRPC::MethodStats::Clock::now() - sendStartTime);
+        },
+        cancellationToken);
+
+        return;
+    }
+    catch (const JSONRPC::JSONRPCException& exc)
+    {
+        JSONRPC::Response response(evt,
+                                   ofJson(nullptr), // null value is required for invalid requests.
+                                   JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INVALID_REQUEST));
+        response.write(buffer, encoding);
+    }
+    catch (const Poco::InvalidArgumentException& exc)
+    {
+        JSONRPC::Response response(evt,
+                                   ofJson(nullptr), // null value is required when parse exceptions
+                                   JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INVALID_PARAMETERS));
+        response.write(buffer, encoding);
+    }
+    catch (const std::exception& exc)
+    {
+        JSONRPC::Response response(evt,
+                                   ofJson(nullptr), // null value is required when parse exceptions
+                                   JSONRPC::Error(JSONRPC::Errors::RPC_ERROR_INTERNAL_ERROR));
+        response.write(buffer, encoding);
+    }
+
+    responseHandler(buffer);
+}
+
+
+template <typename SessionStoreType>
+void JSONRPCServer_<SessionStoreType>::processBatch(const void* pSender,
+                                                    ServerEventArgs& evt,
+                                                    ofJson&& json,
+                                                    JSONRPC::Encoding encoding,
+                                                    ResponseBufferHandler responseHandler,
+                                                    JSONRPC::MethodStats::Clock::duration parseTime,
+                                                    SharedConnectionStatePtr connectionState,
+                                                    JSONRPC::MethodStats::Clock::time_point receivedTime)
+{
+    // Elements may complete on different threads and in any order. The last
+    // element to complete assembles and delivers the batch response.
+    struct BatchState
+    {
+        std::vector<std::string> responses;
+        std::atomic<std::size_t> remaining;
+        ResponseBufferHandler responseHandler;
+    };
+
+    std::shared_ptr<BatchState> state = std::make_shared<BatchState>();
+    state->responses.resize(json.size());
+    state->remaining = json.size();
+    state->responseHandler = responseHandler;
+
+    JSONRPC::MethodStats::Clock::duration elementParseTime = parseTime / json.size();
+
+    auto processElement = [&](std::size_t index)
+    {
+        // Each element is moved out of the batch exactly once.
+        processRequest(pSender, evt, std::move(json[index]), encoding, [state, index, encoding](std::string& response) {
+            state->responses[index] = std::move(response);
+
+            if (--state->remaining == 0)
+            {
+                // Notifications do not have responses, so they are omitted.
+                std::string buffer;
+
+                if (encoding == JSONRPC::Encoding::JSON)
+                {
+                    for (const auto& elementResponse: state->responses)
+                    {
+                        if (!elementResponse.empty())
+                        {
+                            buffer += buffer.empty() ? "[" : ",";
+                            buffer += elementResponse;
+                        }
+                    }
+
+                    if (!buffer.empty())
+                    {
+                        buffer += "]";
+                    }
+                }
+                else
+                {
+                    // Binary arrays are prefixed with their size, so the
+                    // encoded elements are appended after the header.
+                    std::size_t numResponses = 0;
+
+                    for (const auto& elementResponse: state->responses)
+                    {
+                        numResponses += elementResponse.empty() ? 0 : 1;
+                    }
+
+                    if (numResponses > 0)
+                    {
+                        JSONRPC::JSONRPCUtils::writeArrayHeader(numResponses, encoding, buffer);
+
+                        for (const auto& elementResponse: state->responses)
+                        {
+                            buffer += elementResponse;
+                        }
+                    }
+                }
+
+                state->responseHandler(buffer);
+            }
+        },
+        elementParseTime,
+        connectionState,
+        receivedTime);
+    };
+
+    if (this->_settings.processBatchesInParallel && json.size() > 1)
+    {
+        _threadPool->parallelFor(json.size(), processElement);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < json.size(); ++i)
+        {
+            processElement(i);
+        }
+    }
+}
+
+
 
 } } // namespace ofx::HTTP
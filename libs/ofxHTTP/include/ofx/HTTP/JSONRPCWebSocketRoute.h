@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+#pragma once
+
+
+#include "ofx/HTTP/WebSocketRoute.h"
+
+
+namespace ofx {
+namespace HTTP {
+
+
+/// \brief A WebSocketRoute that negotiates the JSONRPC subprotocols.
+///
+/// The first subprotocol offered by the client that selects a JSONRPC
+/// encoding, see JSONRPC::JSONRPCUtils::selectSubprotocol(), is echoed in
+/// the Sec-WebSocket-Protocol header of the handshake response. Offers of
+/// unsupported subprotocols are ignored and the connection uses JSON, so the
+/// header is omitted and clients that require a subprotocol can fail the
+/// connection as RFC 6455 requires.
+class JSONRPCWebSocketRoute: public WebSocketRoute
+{
+public:
+    /// \brief Create a JSONRPCWebSocketRoute.
+    /// \param settings The route settings.
+    JSONRPCWebSocketRoute(const WebSocketRouteSettings& settings = WebSocketRouteSettings());
+
+    /// \brief Destroy the JSONRPCWebSocketRoute.
+    virtual ~JSONRPCWebSocketRoute();
+
+    virtual void handleRequest(ServerEventArgs& evt) override;
+
+};
+
+
+} } // namespace ofx::HTTP
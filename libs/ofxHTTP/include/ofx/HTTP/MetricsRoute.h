@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+#pragma once
+
+
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "ofx/HTTP/BaseServer.h"
+
+
+namespace ofx {
+namespace HTTP {
+
+
+/// \brief Settings for a MetricsRoute.
+class MetricsRouteSettings: public BaseRouteSettings
+{
+public:
+    /// \brief Create MetricsRouteSettings.
+    /// \param routePathPattern The regex pattern that the route will handle.
+    /// \param requireSecurePort True if the route requires a secure port.
+    /// \param requireAuthentication True if the route requires
+    ///        authentication.
+    MetricsRouteSettings(const std::string& routePathPattern = DEFAULT_METRICS_ROUTE_PATH_PATTERN,
+                         bool requireSecurePort = false,
+                         bool requireAuthentication = false);
+
+    /// \brief Destroy the MetricsRouteSettings.
+    virtual ~MetricsRouteSettings();
+
+    /// \brief The default route path pattern, "/metrics".
+    static const std::string DEFAULT_METRICS_ROUTE_PATH_PATTERN;
+
+};
+
+
+/// \brief A route that exposes metrics in the OpenMetrics text format.
+///
+/// The metrics are written by a callback, so that the route can be scraped
+/// by Prometheus or any other OpenMetrics collector without knowing what is
+/// measured. The route terminates the exposition with "# EOF".
+class MetricsRoute: public BaseRoute_<MetricsRouteSettings>
+{
+public:
+    /// \brief A callback that writes metric families to a stream.
+    typedef std::function<void(std::ostream& stream)> MetricsWriter;
+
+    /// \brief Create a MetricsRoute.
+    /// \param settings The route settings.
+    MetricsRoute(const MetricsRouteSettings& settings = MetricsRouteSettings());
+
+    /// \brief Destroy the MetricsRoute.
+    virtual ~MetricsRoute();
+
+    /// \brief Set the callback that writes the metrics.
+    ///
+    /// The callback is called on a server thread for each request.
+    ///
+    /// \param metricsWriter The callback, or nullptr to expose no metrics.
+    void setMetricsWriter(MetricsWriter metricsWriter);
+
+    virtual void handleRequest(ServerEventArgs& evt) override;
+
+    /// \brief Escape a label value for the OpenMetrics text format.
+    /// \param value The unescaped value.
+    /// \returns the value with backslashes, double quotes and line feeds
+    ///          escaped.
+    static std::string escapeLabelValue(const std::string& value);
+
+    /// \brief The content type of the OpenMetrics text format.
+    static const std::string OPEN_METRICS_CONTENT_TYPE;
+
+private:
+    /// \brief The callback that writes the metrics.
+    MetricsWriter _metricsWriter;
+
+    /// \brief The mutex protecting the callback.
+    mutable std::mutex _mutex;
+
+};
+
+
+} } // namespace ofx::HTTP
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/HTTP/JSONRPCWebSocketRoute.h"
+#include "ofx/JSONRPC/JSONRPCUtils.h"
+
+
+namespace ofx {
+namespace HTTP {
+
+
+JSONRPCWebSocketRoute::JSONRPCWebSocketRoute(const WebSocketRouteSettings& settings):
+    WebSocketRoute(settings)
+{
+}
+
+
+JSONRPCWebSocketRoute::~JSONRPCWebSocketRoute()
+{
+}
+
+
+void JSONRPCWebSocketRoute::handleRequest(ServerEventArgs& evt)
+{
+    std::string subprotocol = JSONRPC::JSONRPCUtils::selectSubprotocol(evt.request().get("Sec-WebSocket-Protocol", ""));
+
+    // The handshake keeps the headers already set on the response.
+    if (!subprotocol.empty())
+    {
+        evt.response().set("Sec-WebSocket-Protocol", subprotocol);
+    }
+
+    WebSocketRoute::handleRequest(evt);
+}
+
+
+} } // namespace ofx::HTTP
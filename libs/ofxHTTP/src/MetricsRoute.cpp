@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/HTTP/MetricsRoute.h"
+#include <sstream>
+
+
+namespace ofx {
+namespace HTTP {
+
+
+const std::string MetricsRouteSettings::DEFAULT_METRICS_ROUTE_PATH_PATTERN = "/metrics";
+
+
+MetricsRouteSettings::MetricsRouteSettings(const std::string& routePathPattern,
+                                           bool requireSecurePort,
+                                           bool requireAuthentication):
+    BaseRouteSettings(routePathPattern,
+                      requireSecurePort,
+                      requireAuthentication)
+{
+}
+
+
+MetricsRouteSettings::~MetricsRouteSettings()
+{
+}
+
+
+const std::string MetricsRoute::OPEN_METRICS_CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+
+MetricsRoute::MetricsRoute(const MetricsRouteSettings& settings):
+    BaseRoute_<MetricsRouteSettings>(settings)
+{
+}
+
+
+MetricsRoute::~MetricsRoute()
+{
+}
+
+
+void MetricsRoute::setMetricsWriter(MetricsWriter metricsWriter)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _metricsWriter = metricsWriter;
+}
+
+
+void MetricsRoute::handleRequest(ServerEventArgs& evt)
+{
+    MetricsWriter metricsWriter;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        metricsWriter = _metricsWriter;
+    }
+
+    // The exposition is buffered so that it is sent with a content length.
+    std::ostringstream stream;
+
+    if (metricsWriter)
+    {
+        metricsWriter(stream);
+    }
+
+    stream << "# EOF\n";
+
+    std::string buffer = stream.str();
+
+    evt.response().setContentType(OPEN_METRICS_CONTENT_TYPE);
+    evt.response().sendBuffer(buffer.c_str(), buffer.length());
+}
+
+
+std::string MetricsRoute::escapeLabelValue(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (char c: value)
+    {
+        switch (c)
+        {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += c;
+                break;
+        }
+    }
+
+    return escaped;
+}
+
+
+} } // namespace ofx::HTTP
@@ -25,6 +25,10 @@ public:
     BaseMessage(HTTP::ServerEventArgs& evt,
                 const ofJson& id);
 
+    /// \brief Create a BaseMessage, taking ownership of the id.
+    BaseMessage(HTTP::ServerEventArgs& evt,
+                ofJson&& id);
+
     /// \brief Destroy the BaseMessage.
     virtual ~BaseMessage();
 
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ofx/JSONRPC/Error.h"
+#include "ofx/JSONRPC/Errors.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A handle used to cancel a method call that is in progress.
+///
+/// A CancellationToken is a lightweight, copyable handle and all copies
+/// share the same state. The server cancels a call's token when the client
+/// disconnects, when the client sends a cancel request or when the call's
+/// deadline passes. Long running methods should check isCancelled() or call
+/// throwIfCancelled() regularly and stop early, so that their thread is
+/// free for calls whose results are still wanted.
+///
+/// A cancelled call is completed with the cancellation error, so its
+/// result is ignored if it completes later.
+class CancellationToken
+{
+public:
+    /// \brief A callback called when the token is cancelled.
+    typedef std::function<void()> Callback;
+
+    /// \brief A typedef for the clock used for deadlines.
+    typedef std::chrono::steady_clock Clock;
+
+    /// \brief Create a CancellationToken that is never cancelled.
+    ///
+    /// Such a token does not allocate, so it costs nothing for calls that
+    /// cannot be cancelled.
+    CancellationToken();
+
+    /// \brief Create a CancellationToken that can be cancelled.
+    /// \returns the new token.
+    static CancellationToken create();
+
+    /// \brief Destroy the CancellationToken.
+    virtual ~CancellationToken();
+
+    /// \brief Cancel the call.
+    ///
+    /// The registered callbacks are called on the calling thread.
+    ///
+    /// \param error The error that completes the call.
+    /// \returns true iff this call cancelled the token. Tokens that are
+    ///          never cancelled return false.
+    bool cancel(const Error& error = Error(Errors::RPC_ERROR_REQUEST_CANCELLED)) const;
+
+    /// \returns true iff the token has been cancelled.
+    bool isCancelled() const;
+
+    /// \brief Throw the cancellation error if the token has been cancelled.
+    /// \throws JSONRPCException with the error's code.
+    void throwIfCancelled() const;
+
+    /// \returns the error that the token was cancelled with, or an Error
+    ///          with code Errors::RPC_ERROR_NONE if it is not cancelled.
+    Error error() const;
+
+    /// \brief Register a callback for when the token is cancelled.
+    ///
+    /// If the token is already cancelled, the callback is called
+    /// immediately. The callback must not throw.
+    ///
+    /// \param callback The callback.
+    void onCancel(Callback callback) const;
+
+    /// \brief Set the time after which the call should be cancelled.
+    ///
+    /// This only records the deadline. The MethodRegistry cancels the token
+    /// once the deadline has passed. The deadline must be set before the
+    /// call is processed. A token that is never cancelled becomes
+    /// cancellable.
+    ///
+    /// \param deadline The deadline.
+    void setDeadline(Clock::time_point deadline);
+
+    /// \returns the deadline, or Clock::time_point::max() if there is none.
+    Clock::time_point deadline() const;
+
+    /// \returns true iff the token has a deadline.
+    bool hasDeadline() const;
+
+    /// \returns true iff both tokens share the same state.
+    bool operator == (const CancellationToken& other) const;
+
+    /// \returns true iff the tokens do not share the same state.
+    bool operator != (const CancellationToken& other) const;
+
+private:
+    /// \brief The state shared by all copies of a CancellationToken.
+    struct State
+    {
+        /// \brief True once the token has been cancelled.
+        std::atomic<bool> isCancelled;
+
+        /// \brief The error the token was cancelled with.
+        Error error;
+
+        /// \brief The callbacks to call when the token is cancelled.
+        std::vector<Callback> callbacks;
+
+        /// \brief The deadline.
+        Clock::time_point deadline = Clock::time_point::max();
+
+        /// \brief The mutex protecting the error and callbacks.
+        std::mutex mutex;
+    };
+
+    /// \brief The shared state, or nullptr if the token is never cancelled.
+    std::shared_ptr<State> _state;
+
+};
+
+
+} } // namespace ofx::JSONRPC
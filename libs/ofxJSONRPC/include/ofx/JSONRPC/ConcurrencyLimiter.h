@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ofx/JSONRPC/Scheduler.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief Settings for limiting the number of calls in progress.
+///
+/// Limiting is disabled unless the maximum concurrency is greater than zero.
+struct ConcurrencyPolicy
+{
+    /// \brief The maximum number of calls that may be in progress at once.
+    std::size_t maxConcurrency = 0;
+
+    /// \brief The maximum number of calls that may wait for a free slot.
+    ///
+    /// Calls that arrive when the queue is full are rejected immediately. If
+    /// zero, calls are never queued.
+    std::size_t maxQueuedCalls = 0;
+
+    /// \brief How long a call may wait for a free slot before it is rejected.
+    ///
+    /// If zero, queued calls wait until a slot is free.
+    std::chrono::milliseconds queueTimeout = std::chrono::milliseconds(0);
+
+    /// \returns true iff calls should be limited.
+    bool isEnabled() const
+    {
+        return maxConcurrency > 0;
+    }
+};
+
+
+/// \brief Admits calls up to a maximum concurrency.
+///
+/// Each admitted call holds a Permit until it completes. When the limit is
+/// reached, calls wait in a bounded queue and are admitted in the order they
+/// arrived as permits are released. Calls that cannot be queued, or that
+/// wait longer than the queue timeout, are rejected so that overload is
+/// reported quickly instead of growing latency.
+///
+/// A queued call that receives a released permit is handed to the limiter's
+/// executor, so that the thread that completed the previous call is not
+/// held up by the next one. Without an executor it is started by the thread
+/// that releases the permit.
+class ConcurrencyLimiter: public std::enable_shared_from_this<ConcurrencyLimiter>
+{
+public:
+    /// \brief A slot held by an admitted call.
+    ///
+    /// The slot is released by release() or when the Permit is destroyed.
+    class Permit
+    {
+    public:
+        /// \brief Create a Permit.
+        /// \param limiter The limiter that admitted the call.
+        Permit(std::shared_ptr<ConcurrencyLimiter> limiter);
+
+        /// \brief Destroy the Permit, releasing it if needed.
+        ~Permit();
+
+        Permit(const Permit&) = delete;
+        Permit& operator = (const Permit&) = delete;
+
+        /// \brief Release the slot. Only the first call has an effect.
+        void release();
+
+    private:
+        /// \brief The limiter that admitted the call.
+        std::shared_ptr<ConcurrencyLimiter> _limiter;
+
+        /// \brief True once the slot has been released.
+        std::atomic<bool> _isReleased;
+
+    };
+
+    /// \brief A shared pointer to a Permit.
+    typedef std::shared_ptr<Permit> SharedPermitPtr;
+
+    /// \brief A callback that starts an admitted call.
+    ///
+    /// The callback must not throw.
+    typedef std::function<void(SharedPermitPtr permit)> Task;
+
+    /// \brief A callback that receives the reason a call was rejected.
+    typedef std::function<void(const std::string& reason)> RejectHandler;
+
+    /// \brief A callback that runs a function on another thread.
+    typedef std::function<void(std::function<void()> function)> Executor;
+
+    /// \brief Statistics, used to tune a ConcurrencyPolicy.
+    struct Stats
+    {
+        /// \brief The number of calls in progress.
+        std::size_t numActiveCalls = 0;
+
+        /// \brief The number of calls waiting for a slot.
+        std::size_t numQueuedCalls = 0;
+
+        /// \brief The number of calls admitted.
+        uint64_t numAdmitted = 0;
+
+        /// \brief The number of calls rejected because the queue was full.
+        uint64_t numRejected = 0;
+
+        /// \brief The number of calls rejected after the queue timeout.
+        uint64_t numTimedOut = 0;
+    };
+
+    /// \brief Create a ConcurrencyLimiter.
+    /// \param policy The concurrency policy.
+    /// \param scheduler The timer used for queue timeouts.
+    /// \param executor Starts queued calls once they are admitted, or
+    ///        nullptr to start them on the thread that releases a permit.
+    /// \param timeoutExecutor Rejects queued calls whose timeout has passed,
+    ///        or nullptr to reject them on the scheduler's timer thread.
+    ConcurrencyLimiter(const ConcurrencyPolicy& policy,
+                       std::shared_ptr<Scheduler> scheduler,
+                       Executor executor = nullptr,
+                       Executor timeoutExecutor = nullptr);
+
+    /// \brief Destroy the ConcurrencyLimiter.
+    virtual ~ConcurrencyLimiter();
+
+    /// \brief Admit, queue or reject a call.
+    ///
+    /// Exactly one of the callbacks is called, either before this function
+    /// returns or later if the call is queued.
+    ///
+    /// \param task Starts the call once it is admitted.
+    /// \param rejectHandler Called if the call is rejected.
+    void submit(Task task, RejectHandler rejectHandler);
+
+    /// \returns the current statistics.
+    Stats stats() const;
+
+    /// \returns the concurrency policy.
+    ConcurrencyPolicy policy() const;
+
+    /// \brief Change the concurrency policy.
+    ///
+    /// Calls in progress keep their permits and count towards the new limit.
+    /// If the limit is raised, queued calls are admitted into the free
+    /// slots. If it is lowered, released permits are not passed on until
+    /// the number of calls in progress is below the new limit. Calls that
+    /// are already queued keep their timeouts.
+    ///
+    /// \param policy The new concurrency policy.
+    void setPolicy(const ConcurrencyPolicy& policy);
+
+private:
+    /// \brief A call waiting for a slot.
+    struct QueuedCall
+    {
+        /// \brief Starts the call.
+        Task task;
+
+        /// \brief Rejects the call.
+        RejectHandler rejectHandler;
+
+        /// \brief The scheduled timeout, if any.
+        Scheduler::TaskId timeoutId = 0;
+    };
+
+    /// \brief Release a slot, passing it to the next queued call if any.
+    void _release();
+
+    /// \brief Reject a queued call whose timeout has passed.
+    /// \param callId The id of the queued call.
+    void _timeout(uint64_t callId);
+
+    /// \brief Admit the oldest queued call.
+    ///
+    /// This must be called while holding the mutex with a non-empty queue.
+    ///
+    /// \returns the task of the admitted call.
+    Task _admitQueuedCall();
+
+    /// \brief Start a queued call that received a slot.
+    ///
+    /// The call is handed to the executor if there is one. Otherwise, calls
+    /// that receive a slot while a queued call is being started on the same
+    /// thread are started after it returns, so that a chain of synchronous
+    /// calls does not grow the stack.
+    ///
+    /// \param task The call to start.
+    void _start(Task task);
+
+    /// \brief The concurrency policy.
+    ConcurrencyPolicy _policy;
+
+    /// \brief The timer used for queue timeouts.
+    std::shared_ptr<Scheduler> _scheduler;
+
+    /// \brief Starts queued calls once they are admitted, if set.
+    Executor _executor;
+
+    /// \brief Rejects queued calls whose timeout has passed, if set.
+    Executor _timeoutExecutor;
+
+    /// \brief The queued calls, in the order they arrived.
+    std::map<uint64_t, QueuedCall> _queuedCalls;
+
+    /// \brief The id of the next queued call.
+    uint64_t _nextCallId = 0;
+
+    /// \brief The statistics.
+    Stats _stats;
+
+    /// \brief The mutex protecting the queue and statistics.
+    mutable std::mutex _mutex;
+
+};
+
+
+} } // namespace ofx::JSONRPC
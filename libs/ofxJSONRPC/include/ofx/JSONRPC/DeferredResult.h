@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "ofJson.h"
+#include "ofx/JSONRPC/CancellationToken.h"
+#include "ofx/JSONRPC/Error.h"
+#include "ofx/JSONRPC/Request.h"
+#include "ofx/JSONRPC/Response.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A handle used to complete a method call at a later time.
+///
+/// A DeferredResult is a lightweight, copyable handle. It can be passed to
+/// any thread and completed with resolve() or reject() once the result of
+/// the call is available. Only the first completion has an effect, all
+/// later completions are ignored.
+///
+/// If every copy of a DeferredResult is destroyed before it is completed,
+/// the call is rejected with Errors::RPC_ERROR_INTERNAL_ERROR so that the
+/// caller always receives a response.
+///
+/// If the call's CancellationToken is cancelled first, the call is rejected
+/// with the cancellation error and later completions are ignored.
+///
+/// The call is finished once it has been completed by the method, or once
+/// every copy of the DeferredResult has been destroyed. A cancelled call is
+/// answered early but is not finished until the method stops working on it.
+///
+/// A DeferredResult may outlive the server event of its Request, so the
+/// Response it creates refers to DetachedServerEvent::sharedArgs() instead.
+class DeferredResult
+{
+public:
+    /// \brief A callback that receives the Response of a call.
+    typedef std::function<void(Response& response)> ResponseHandler;
+
+    /// \brief A callback that is called once the call has finished.
+    typedef std::function<void()> FinishHandler;
+
+    /// \brief Create a DeferredResult.
+    /// \param request The Request that will be completed.
+    /// \param responseHandler The callback that will receive the Response.
+    ///        If empty, as for notifications, no Response is created.
+    /// \param cancellationToken The token that cancels the call.
+    /// \param finishHandler The callback that is called once the call has
+    ///        finished, or empty.
+    DeferredResult(const Request& request,
+                   ResponseHandler responseHandler,
+                   const CancellationToken& cancellationToken = CancellationToken(),
+                   FinishHandler finishHandler = nullptr);
+
+    /// \brief Destroy the DeferredResult.
+    virtual ~DeferredResult();
+
+    /// \brief Complete the call successfully.
+    ///
+    /// Completing a DeferredResult also finishes the call, even if the
+    /// completion is ignored because the call was cancelled.
+    ///
+    /// \param result The result of the call.
+    /// \returns true iff this call completed the DeferredResult.
+    bool resolve(const ofJson& result) const;
+
+    /// \brief Complete the call successfully with a serialized result.
+    /// \param serializedResult The result of the call, already serialized,
+    ///        e.g. with Response::serializeResult().
+    /// \returns true iff this call completed the DeferredResult.
+    bool resolveSerialized(Response::SerializedResult serializedResult) const;
+
+    /// \brief Complete the call with an error.
+    /// \param error The error. The Error MUST contain a valid error code.
+    /// \returns true iff this call completed the DeferredResult.
+    bool reject(const Error& error) const;
+
+    /// \returns true iff the DeferredResult has been completed.
+    bool isCompleted() const;
+
+    /// \returns the token that cancels the call.
+    const CancellationToken& cancellationToken() const;
+
+private:
+    /// \brief The state shared by all copies of a DeferredResult.
+    class State
+    {
+    public:
+        State(const Request& request,
+              ResponseHandler responseHandler,
+              const CancellationToken& cancellationToken,
+              FinishHandler finishHandler);
+
+        ~State();
+
+        /// \brief Complete the call with the given Response.
+        bool complete(Response& response);
+
+        /// \brief Complete the call without a Response.
+        bool complete();
+
+        /// \brief Finish the call if it has not been finished.
+        void finish();
+
+        /// \brief The id of the Request.
+        ofJson id;
+
+        /// \brief The callback that receives the Response.
+        ResponseHandler responseHandler;
+
+        /// \brief The token that cancels the call.
+        CancellationToken cancellationToken;
+
+        /// \brief The callback that is called once the call has finished.
+        FinishHandler finishHandler;
+
+        /// \brief True once the call has been completed.
+        std::atomic<bool> isCompleted;
+
+        /// \brief True once the call has finished.
+        std::atomic<bool> isFinished;
+    };
+
+    /// \brief The shared state.
+    std::shared_ptr<State> _state;
+
+};
+
+
+} } // namespace ofx::JSONRPC
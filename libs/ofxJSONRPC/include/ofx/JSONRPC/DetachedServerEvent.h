@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <memory>
+#include "ofx/HTTP/ServerEvents.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief Server event arguments that do not belong to a client request.
+///
+/// The request is empty and anything sent in the response is discarded.
+/// They stand in for the originating server event where that event may no
+/// longer be valid, e.g. for a Response completed after its request has
+/// been answered or its connection has closed, and let messages be
+/// processed in-process without sockets.
+class DetachedServerEvent
+{
+public:
+    /// \brief Create a DetachedServerEvent with its own request, response
+    ///        and session.
+    DetachedServerEvent();
+
+    /// \brief Destroy the DetachedServerEvent.
+    virtual ~DetachedServerEvent();
+
+    DetachedServerEvent(const DetachedServerEvent&) = delete;
+    DetachedServerEvent& operator = (const DetachedServerEvent&) = delete;
+
+    /// \returns the server event arguments.
+    HTTP::ServerEventArgs& args();
+
+    /// \brief Get server event arguments shared by all threads.
+    ///
+    /// The request and response must not be modified.
+    ///
+    /// \returns the shared server event arguments.
+    static HTTP::ServerEventArgs& sharedArgs();
+
+private:
+    /// \brief The response that discards anything sent.
+    std::unique_ptr<Poco::Net::HTTPServerResponse> _response;
+
+    /// \brief The empty request.
+    std::unique_ptr<Poco::Net::HTTPServerRequest> _request;
+
+    /// \brief The session of the request.
+    std::unique_ptr<HTTP::AbstractSession> _session;
+
+    /// \brief The event arguments referring to the request and response.
+    std::unique_ptr<HTTP::ServerEventArgs> _args;
+
+};
+
+
+} } // namespace ofx::JSONRPC
@@ -0,0 +1,30 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief The wire encodings that JSONRPC messages can be sent in.
+///
+/// The binary encodings carry the same JSONRPC 2.0 message objects as JSON
+/// text, but are smaller and faster to parse, especially for numeric data.
+enum class Encoding
+{
+    /// \brief JSON text.
+    JSON,
+    /// \brief Concise Binary Object Representation (RFC 7049).
+    CBOR,
+    /// \brief MessagePack.
+    MESSAGE_PACK
+};
+
+
+} } // namespace ofx::JSONRPC
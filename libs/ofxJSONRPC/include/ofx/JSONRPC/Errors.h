@@ -48,6 +48,24 @@ public:
     /// \brief Parse Error.
     static const int RPC_ERROR_PARSE;
 
+    /// \brief Server Busy.
+    ///
+    /// A server error returned when a call is rejected because too many
+    /// calls are already in progress. The call may be retried later.
+    static const int RPC_ERROR_SERVER_BUSY;
+
+    /// \brief Deadline Exceeded.
+    ///
+    /// A server error returned when a call does not complete before its
+    /// deadline.
+    static const int RPC_ERROR_DEADLINE_EXCEEDED;
+
+    /// \brief Request Cancelled.
+    ///
+    /// Returned when a call is cancelled by the client. This is the code
+    /// used by the Language Server Protocol's $/cancelRequest.
+    static const int RPC_ERROR_REQUEST_CANCELLED;
+
 };
 
 
@@ -80,6 +98,21 @@ POCO_DECLARE_EXCEPTION_CODE(,
                             ParseException,
                             JSONRPCException,
                             Errors::RPC_ERROR_PARSE)
+
+POCO_DECLARE_EXCEPTION_CODE(,
+                            ServerBusyException,
+                            JSONRPCException,
+                            Errors::RPC_ERROR_SERVER_BUSY)
+
+POCO_DECLARE_EXCEPTION_CODE(,
+                            DeadlineExceededException,
+                            JSONRPCException,
+                            Errors::RPC_ERROR_DEADLINE_EXCEEDED)
+
+POCO_DECLARE_EXCEPTION_CODE(,
+                            RequestCancelledException,
+                            JSONRPCException,
+                            Errors::RPC_ERROR_REQUEST_CANCELLED)
     
 
 } } // namespace ofx::JSONRPC
@@ -8,9 +8,14 @@
 #pragma once
 
 
+#include <cstdint>
+#include <streambuf>
 #include <string>
+#include <vector>
 #include "json.hpp"
+#include "ofFileUtils.h"
 #include "Poco/UUID.h"
+#include "ofx/JSONRPC/Encoding.h"
 #include "ofx/JSONRPC/Errors.h"
 #include "ofx/JSONRPC/Response.h"
 #include "ofx/JSONRPC/Request.h"
@@ -24,6 +29,27 @@ namespace JSONRPC {
 class JSONRPCUtils
 {
 public:
+    /// \brief A stream buffer that appends everything written to a string.
+    ///
+    /// This allows JSON to be serialized with std::ostream directly into a
+    /// reusable std::string without an intermediate copy.
+    class StringStreamBuffer: public std::streambuf
+    {
+    public:
+        /// \brief Create a StringStreamBuffer.
+        /// \param buffer The string to append to.
+        StringStreamBuffer(std::string& buffer);
+
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+    private:
+        /// \brief The string to append to.
+        std::string& _buffer;
+
+    };
+
     /// \brief Convert JSON values to a raw string representation.
     /// \param json The JSON value to convert.
     /// \param styled If true, the raw string will be indented
@@ -31,6 +57,90 @@ public:
     /// \returns A std::string representation of the JSON.
     static std::string toString(const ofJson& json, bool styled = false);
 
+    /// \brief Parse JSON directly from the bytes of a buffer.
+    ///
+    /// Unlike ofJson::parse(buffer.getText()), this does not copy the
+    /// buffer into an intermediate std::string.
+    ///
+    /// \param buffer The buffer containing the raw JSON text.
+    /// \returns the parsed JSON.
+    /// \throws an exception if the buffer does not contain valid JSON.
+    static ofJson parse(const ofBuffer& buffer);
+
+    /// \brief Parse JSON from the bytes of a buffer in the given encoding.
+    /// \param buffer The buffer containing the encoded JSON.
+    /// \param encoding The encoding of the buffer.
+    /// \returns the parsed JSON.
+    /// \throws an exception if the buffer does not contain valid data.
+    static ofJson parse(const ofBuffer& buffer, Encoding encoding);
+
+    /// \brief Append JSON to a buffer in the given encoding.
+    /// \param json The JSON value to write.
+    /// \param encoding The encoding to write.
+    /// \param buffer The buffer to append to.
+    static void write(const ofJson& json,
+                      Encoding encoding,
+                      std::string& buffer);
+
+    /// \brief Append the header of an array to a buffer.
+    ///
+    /// Binary encodings prefix an array with its size, so an array can be
+    /// assembled by appending this header followed by its already encoded
+    /// elements, without decoding and re-encoding them.
+    ///
+    /// \param size The number of elements in the array.
+    /// \param encoding The binary encoding to write. Must not be JSON.
+    /// \param buffer The buffer to append to.
+    static void writeArrayHeader(std::size_t size,
+                                 Encoding encoding,
+                                 std::string& buffer);
+
+    /// \brief Select a subprotocol from the subprotocols offered by a client.
+    ///
+    /// The subprotocols are given as the comma separated value of a
+    /// Sec-WebSocket-Protocol header. The first supported subprotocol wins
+    /// and unsupported subprotocols are ignored. Each encoding's subprotocol
+    /// is supported with and without the COALESCE_SUBPROTOCOL_SUFFIX.
+    ///
+    /// \param subprotocols The subprotocols offered by the client.
+    /// \returns the selected subprotocol, or an empty string if none of the
+    ///          subprotocols are supported.
+    static std::string selectSubprotocol(const std::string& subprotocols);
+
+    /// \brief Select an encoding from the subprotocols offered by a client.
+    ///
+    /// The encoding is the one of the subprotocol chosen by
+    /// selectSubprotocol(), so that it matches the subprotocol the server
+    /// confirms to the client.
+    ///
+    /// \param subprotocols The subprotocols offered by the client.
+    /// \returns the selected encoding, or Encoding::JSON if no binary
+    ///          encoding was selected.
+    static Encoding encodingForSubprotocols(const std::string& subprotocols);
+
+    /// \brief Determine whether a client accepts coalesced responses.
+    ///
+    /// Clients that offer a subprotocol with the COALESCE_SUBPROTOCOL_SUFFIX,
+    /// e.g. "jsonrpc-cbor+coalesce", accept responses to separate requests
+    /// combined in one array, like a batch response.
+    ///
+    /// \param subprotocols The subprotocols offered by the client.
+    /// \returns true iff the subprotocol chosen by selectSubprotocol() has
+    ///          the suffix.
+    static bool isCoalescingSubprotocol(const std::string& subprotocols);
+
+    /// \brief The WebSocket subprotocol that selects Encoding::JSON.
+    static const std::string JSON_SUBPROTOCOL;
+
+    /// \brief The WebSocket subprotocol that selects Encoding::CBOR.
+    static const std::string CBOR_SUBPROTOCOL;
+
+    /// \brief The WebSocket subprotocol that selects Encoding::MESSAGE_PACK.
+    static const std::string MESSAGE_PACK_SUBPROTOCOL;
+
+    /// \brief The suffix of a subprotocol that accepts coalesced responses.
+    static const std::string COALESCE_SUBPROTOCOL_SUFFIX;
+
     /// \brief Determine whether the given json has the named key.
     /// \param json The json to check.
     /// \param key The key to check.
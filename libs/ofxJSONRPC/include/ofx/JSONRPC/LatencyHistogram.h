@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "ofJson.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A lock-free histogram of latencies in microseconds.
+///
+/// Values are counted in log-linear buckets in the style of an HDR
+/// histogram. Values below 32 are counted exactly and larger values are
+/// counted in 16 buckets per power of two, so any reported percentile is
+/// within about 6% of the recorded value. Values above the largest bucket,
+/// about 19 hours, are counted in the largest bucket.
+///
+/// Recording a value is a few relaxed atomic operations, so a histogram can
+/// be shared by many threads without a lock.
+class LatencyHistogram
+{
+public:
+    /// \brief The number of values counted exactly.
+    static const std::size_t NUM_EXACT_VALUES = 32;
+
+    /// \brief The number of buckets per power of two above the exact values.
+    static const std::size_t NUM_SUB_BUCKETS = 16;
+
+    /// \brief The number of powers of two above the exact values.
+    static const std::size_t NUM_OCTAVES = 31;
+
+    /// \brief The total number of buckets.
+    static const std::size_t NUM_BUCKETS = NUM_EXACT_VALUES + NUM_OCTAVES * NUM_SUB_BUCKETS;
+
+    /// \brief A copy of the histogram at one point in time.
+    struct Snapshot
+    {
+        /// \brief The number of recorded values.
+        uint64_t count = 0;
+
+        /// \brief The smallest recorded value.
+        uint64_t min = 0;
+
+        /// \brief The largest recorded value.
+        uint64_t max = 0;
+
+        /// \brief The sum of the recorded values.
+        uint64_t sum = 0;
+
+        /// \brief The count of each bucket.
+        std::vector<uint64_t> counts;
+
+        /// \returns the mean of the recorded values, or 0 if there are none.
+        double mean() const;
+
+        /// \brief Get a percentile of the recorded values.
+        /// \param percentile The percentile in the range [0, 100].
+        /// \returns the largest value in the bucket containing the
+        ///          percentile, limited to the recorded maximum, or 0 if
+        ///          there are no recorded values.
+        uint64_t percentile(double percentile) const;
+
+        /// \brief Serialize a Snapshot as a JSON object.
+        ///
+        /// The object contains the count, min, max, mean and the 50th, 90th,
+        /// 99th and 99.9th percentiles.
+        ///
+        /// \param snapshot The Snapshot to serialize.
+        /// \returns the JSON object.
+        static ofJson toJSON(const Snapshot& snapshot);
+    };
+
+    /// \brief Create an empty LatencyHistogram.
+    LatencyHistogram();
+
+    /// \brief Destroy the LatencyHistogram.
+    virtual ~LatencyHistogram();
+
+    /// \brief Record a value.
+    /// \param value The value in microseconds.
+    void record(uint64_t value);
+
+    /// \returns a copy of the histogram.
+    ///
+    /// Values recorded while the copy is made may be partially included.
+    Snapshot snapshot() const;
+
+    /// \brief Remove all recorded values.
+    void reset();
+
+    /// \brief Get the bucket that counts a value.
+    /// \param value The value.
+    /// \returns the index of the bucket.
+    static std::size_t bucketIndex(uint64_t value);
+
+    /// \brief Get the largest value counted by a bucket.
+    /// \param index The index of the bucket.
+    /// \returns the largest value.
+    static uint64_t bucketUpperBound(std::size_t index);
+
+private:
+    /// \brief The count of each bucket.
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> _counts;
+
+    /// \brief The smallest recorded value.
+    std::atomic<uint64_t> _min;
+
+    /// \brief The largest recorded value.
+    std::atomic<uint64_t> _max;
+
+    /// \brief The sum of the recorded values.
+    std::atomic<uint64_t> _sum;
+
+};
+
+
+} } // namespace ofx::JSONRPC
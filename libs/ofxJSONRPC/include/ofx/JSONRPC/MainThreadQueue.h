@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include "ofEvents.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A queue of tasks that are executed on the main thread.
+///
+/// Any thread may submit tasks without taking a lock. Once started, the
+/// queue is drained once per ofEvents().update, executing all pending tasks
+/// in the order they were submitted. Draining the queue takes a single
+/// atomic exchange, regardless of the number of tasks.
+class MainThreadQueue
+{
+public:
+    /// \brief A typedef for a task.
+    typedef std::function<void()> Task;
+
+    /// \brief Create a MainThreadQueue.
+    MainThreadQueue();
+
+    /// \brief Destroy the MainThreadQueue.
+    ///
+    /// Pending tasks are discarded without being executed.
+    virtual ~MainThreadQueue();
+
+    /// \brief Start draining the queue on each ofEvents().update.
+    ///
+    /// This should be called from the main thread once the application's
+    /// window exists, e.g. from ofApp::setup(). Calling it again has no
+    /// effect.
+    void start();
+
+    /// \brief Submit a task for execution on the main thread.
+    /// \param task The task to execute. The task must not throw.
+    void submit(Task task);
+
+    /// \brief Execute all pending tasks on the calling thread.
+    /// \returns the number of tasks executed.
+    std::size_t drain();
+
+    /// \brief Discard all pending tasks without executing them.
+    void clear();
+
+    /// \brief Drain the queue.
+    /// \param args The update event arguments.
+    void onUpdate(ofEventArgs& args);
+
+private:
+    /// \brief A node in the intrusive list of pending tasks.
+    struct Node
+    {
+        Task task;
+        Node* next = nullptr;
+    };
+
+    /// \brief Detach all pending tasks in the order they were submitted.
+    /// \returns the first pending task or nullptr if there are none.
+    Node* _takeAll();
+
+    /// \brief The most recently submitted task.
+    ///
+    /// Tasks are pushed onto the front of the list, so the list is in
+    /// reverse submission order.
+    std::atomic<Node*> _head;
+
+    /// \brief Ensures the update listener is only added once.
+    std::once_flag _startFlag;
+
+    /// \brief True once the update listener has been added.
+    std::atomic<bool> _isStarted;
+
+};
+
+
+} } // namespace ofx::JSONRPC
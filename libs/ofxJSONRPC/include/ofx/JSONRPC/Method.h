@@ -18,6 +18,23 @@ namespace ofx {
 namespace JSONRPC {
 
 
+/// \brief The thread that a registered method is invoked on.
+enum class MethodDispatch
+{
+    /// \brief Invoke the method on the thread that processes the request.
+    ///
+    /// The method may be invoked concurrently from multiple threads and is
+    /// responsible for its own thread-safety.
+    ANY_THREAD,
+    /// \brief Invoke the method on the main thread during ofEvents().update.
+    ///
+    /// Calls are queued and executed in the order they were received, so
+    /// the method may safely access OpenGL and application state without
+    /// locking. The response is sent after the method completes.
+    MAIN_THREAD
+};
+
+
 /// \brief A method callback class for registering JSONRPC methods.
 template<typename EventType>
 class Method_
@@ -57,6 +74,7 @@ private:
 
 typedef Method_<ofEvent<MethodArgs> > Method;
 typedef Method_<ofEvent<void> > NoArgMethod;
+typedef Method_<ofEvent<DeferredMethodArgs> > DeferredMethod;
 
 
 template<typename ArgType>
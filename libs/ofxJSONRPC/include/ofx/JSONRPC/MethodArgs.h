@@ -10,6 +10,8 @@
 
 #include <string>
 #include "ofx/HTTP/ServerEvents.h"
+#include "ofx/JSONRPC/CancellationToken.h"
+#include "ofx/JSONRPC/DeferredResult.h"
 #include "ofx/JSONRPC/JSONRPCUtils.h"
 
 
@@ -40,6 +42,12 @@ public:
     MethodArgs(HTTP::ServerEventArgs&,
                const ofJson& params);
 
+    /// \brief Create a MethodArgs, taking ownership of the parameters.
+    /// \param params The JSON contents of the JSONRPC request params.
+    ///        If there are no arguments provided, the params are null.
+    MethodArgs(HTTP::ServerEventArgs&,
+               ofJson&& params);
+
     /// \brief Destroy the MethodArgs.
     virtual ~MethodArgs();
 
@@ -49,6 +57,13 @@ public:
     /// \brief The result to be returned, if required.
     ofJson result;
 
+    /// \brief The result to be returned, already serialized.
+    ///
+    /// If set, this is returned instead of result. This allows a method to
+    /// return a constant or precomputed result, created once with
+    /// Response::serializeResult(), without serializing it for every call.
+    Response::SerializedResult serializedResult;
+
     /// \brief The error to be returned, if required.
     ///
     /// If the Error object is set to an error code other than RPC_ERROR_NONE,
@@ -59,6 +74,35 @@ public:
     /// remote method.
     Error error;
 
+    /// \brief The token that is cancelled when the result is no longer
+    ///        wanted.
+    ///
+    /// Long running methods should check the token regularly, e.g. with
+    /// CancellationToken::throwIfCancelled(), and stop early once it is
+    /// cancelled.
+    CancellationToken cancellationToken;
+
+    /// \brief The time by which the call should complete.
+    ///
+    /// The call is cancelled when the deadline passes. If the call has no
+    /// deadline, this is CancellationToken::Clock::time_point::max().
+    CancellationToken::Clock::time_point deadline;
+
+    /// \brief The WebSocket connection that sent the call.
+    ///
+    /// This is nullptr if the call was not sent over a WebSocket connection,
+    /// e.g. in a POST request. The connection is only guaranteed to be open
+    /// until the method returns and should be identified by connectionId
+    /// after that.
+    const HTTP::WebSocketConnection* connection;
+
+    /// \brief The id of the WebSocket connection that sent the call.
+    ///
+    /// Ids are unique among the connections of a server, even if a later
+    /// connection reuses the address of a closed one. This is 0 if there
+    /// is no connection.
+    uint64_t connectionId;
+
     /// \brief Get the MethodArgs as a string.
     /// \param styled true if the output string should be pretty-print.
     /// \returns a raw json string of this MethodArgs
@@ -67,4 +111,48 @@ public:
 };
 
 
+/// \brief Arguments for a JSONRPC method call that completes asynchronously.
+///
+/// A deferred method does not need to produce its result before returning.
+/// Instead, it keeps a copy of the DeferredResult and completes it later,
+/// from any thread, by calling DeferredResult::resolve() or
+/// DeferredResult::reject(). This frees the server thread that delivered
+/// the call while a slow operation is in progress.
+///
+/// The MethodArgs::result member is ignored for deferred methods. Setting
+/// MethodArgs::error or throwing an exception before returning rejects the
+/// call immediately.
+///
+/// \warning The originating ServerEventArgs are only guaranteed to be valid
+///          until the method returns and should not be accessed when the
+///          result is completed later.
+class DeferredMethodArgs: public MethodArgs
+{
+public:
+    /// \brief Create a DeferredMethodArgs with the given parameters.
+    /// \param params The JSON contents of the JSONRPC request params.
+    ///        If there are no arguments provided, the params are null.
+    /// \param deferredResult The handle used to complete the call.
+    DeferredMethodArgs(HTTP::ServerEventArgs& evt,
+                       const ofJson& params,
+                       const DeferredResult& deferredResult);
+
+    /// \brief Create a DeferredMethodArgs, taking ownership of the
+    ///        parameters.
+    /// \param params The JSON contents of the JSONRPC request params.
+    ///        If there are no arguments provided, the params are null.
+    /// \param deferredResult The handle used to complete the call.
+    DeferredMethodArgs(HTTP::ServerEventArgs& evt,
+                       ofJson&& params,
+                       const DeferredResult& deferredResult);
+
+    /// \brief Destroy the DeferredMethodArgs.
+    virtual ~DeferredMethodArgs();
+
+    /// \brief The handle used to complete the call.
+    DeferredResult deferredResult;
+
+};
+
+
 } } // namespace ofx::JSONRPC
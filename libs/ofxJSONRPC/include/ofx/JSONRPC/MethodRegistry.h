@@ -8,15 +8,28 @@
 #pragma once
 
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include "json.hpp"
+#include "ofx/JSONRPC/CancellationToken.h"
+#include "ofx/JSONRPC/ConcurrencyLimiter.h"
 #include "ofEvents.h"
 #include "ofLog.h"
+#include "ofx/JSONRPC/DeferredResult.h"
+#include "ofx/JSONRPC/MainThreadQueue.h"
 #include "ofx/JSONRPC/Method.h"
 #include "ofx/JSONRPC/MethodArgs.h"
+#include "ofx/JSONRPC/MethodStats.h"
 #include "ofx/JSONRPC/Response.h"
 #include "ofx/JSONRPC/Request.h"
+#include "ofx/JSONRPC/ResultCache.h"
+#include "ofx/JSONRPC/Scheduler.h"
+#include "ofx/JSONRPC/Task.h"
+#include "ofx/JSONRPC/ThreadPool.h"
 
 
 namespace ofx {
@@ -27,12 +40,38 @@ namespace JSONRPC {
 ///
 /// Additionally, a MethodRegistry is in charge of invoking methods by
 /// name using the method signature defined in Method.
+///
+/// Methods are stored in an immutable MethodTable that is replaced
+/// atomically whenever a method is registered or unregistered. Looking up a
+/// method to process a call never takes a lock.
+///
+/// Methods registered with MethodDispatch::MAIN_THREAD are queued and
+/// invoked during ofEvents().update, so the application's update loop must
+/// be running for their calls to complete.
+///
+/// The server event of a Request is only valid while it is being processed.
+/// Calls that may be queued, i.e. main thread calls from other threads,
+/// calls to methods with a concurrency limit and notifications processed on
+/// a ThreadPool, are invoked with DetachedServerEvent::sharedArgs() instead,
+/// so their methods must identify the client by MethodArgs::connectionId.
+///
+/// Methods registered with an enabled CachePolicy must be idempotent. Calls
+/// with the same parameters are answered from the cache, without invoking
+/// the method, until the cached result expires.
+///
+/// If statistics are enabled with setStatsEnabled(), every call and
+/// notification is counted and the latency of each call is recorded in the
+/// MethodStats of its method. When statistics are disabled, calls are not
+/// timed at all.
 class MethodRegistry
 {
 public:
     /// \brief A typedef mapping method names to method descriptions.
     typedef std::map<std::string, ofJson> MethodDescriptionMap;
 
+    /// \brief A callback that receives the Response of a call.
+    typedef DeferredResult::ResponseHandler ResponseHandler;
+
     /// \brief Create a MethodRegistry.
     MethodRegistry();
 
@@ -56,12 +95,16 @@ public:
     /// \param listener A pointer to the listener class.
     /// \param listenerMethod A pointer to the method to invoke.
     /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
     template <class ListenerClass>
     void registerMethod(const std::string& name,
                         const ofJson& description,
                         ListenerClass* listener,
                         void (ListenerClass::*listenerMethod)(const void*, MethodArgs&),
-                        int priority = OF_EVENT_ORDER_AFTER_APP);
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
 
     /// \brief Register a method callback.
     ///
@@ -80,12 +123,16 @@ public:
     /// \param listener A pointer to the listener class.
     /// \param listenerMethod A pointer to the method to invoke.
     /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
     template <class ListenerClass>
     void registerMethod(const std::string& name,
                         const ofJson& description,
                         ListenerClass* listener,
                         void (ListenerClass::*listenerMethod)(MethodArgs&),
-                        int priority = OF_EVENT_ORDER_AFTER_APP);
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
 
     /// \brief Register a no argument method callback.
     ///
@@ -104,12 +151,16 @@ public:
     /// \param listener A pointer to the listener class.
     /// \param listenerMethod A pointer to the method to invoke.
     /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
     template <class ListenerClass>
     void registerMethod(const std::string& name,
                         const ofJson& description,
                         ListenerClass* listener,
                         void (ListenerClass::*listenerMethod)(const void*),
-                        int priority = OF_EVENT_ORDER_AFTER_APP);
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
 
     /// \brief Register a no argument method callback.
     ///
@@ -128,20 +179,163 @@ public:
     /// \param listener A pointer to the listener class.
     /// \param listenerMethod A pointer to the method to invoke.
     /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
     template <class ListenerClass>
     void registerMethod(const std::string& name,
                         const ofJson& description,
                         ListenerClass* listener,
                         void (ListenerClass::*listenerMethod)(void),
-                        int priority = OF_EVENT_ORDER_AFTER_APP);
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Register a deferred method callback.
+    ///
+    /// Each method needs a name, description, class and method.  This method
+    /// registers remote methods with the following signature:
+    ///
+    /// ~~~{.cpp}
+    ///     void ListenerClass::listenerMethod(const void* pSender, DeferredMethodArgs& args);
+    /// ~~~
+    ///
+    /// The call is completed when the listener method, or any other thread,
+    /// completes args.deferredResult.
+    ///
+    /// \param name The name of the class to be called by the client.
+    /// \param description A JSON description of any information to
+    ///        advertise with this method.  This might include a
+    ///        description of the functionality, the input / output
+    ///        arguments, expected values, etc.
+    /// \param listener A pointer to the listener class.
+    /// \param listenerMethod A pointer to the method to invoke.
+    /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    template <class ListenerClass>
+    void registerMethod(const std::string& name,
+                        const ofJson& description,
+                        ListenerClass* listener,
+                        void (ListenerClass::*listenerMethod)(const void*, DeferredMethodArgs&),
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Register a deferred method callback.
+    ///
+    /// Each method needs a name, description, class and method.  This method
+    /// registers remote methods with the following signature:
+    ///
+    /// ~~~{.cpp}
+    ///     void ListenerClass::listenerMethod(DeferredMethodArgs& args);
+    /// ~~~
+    ///
+    /// The call is completed when the listener method, or any other thread,
+    /// completes args.deferredResult.
+    ///
+    /// \param name The name of the class to be called by the client.
+    /// \param description A JSON description of any information to
+    ///        advertise with this method.  This might include a
+    ///        description of the functionality, the input / output
+    ///        arguments, expected values, etc.
+    /// \param listener A pointer to the listener class.
+    /// \param listenerMethod A pointer to the method to invoke.
+    /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    template <class ListenerClass>
+    void registerMethod(const std::string& name,
+                        const ofJson& description,
+                        ListenerClass* listener,
+                        void (ListenerClass::*listenerMethod)(DeferredMethodArgs&),
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
+
+#if OFX_JSONRPC_HAS_COROUTINES
+    /// \brief Register a coroutine method callback.
+    ///
+    /// Each method needs a name, description, class and method.  This method
+    /// registers remote methods with the following signature:
+    ///
+    /// ~~~{.cpp}
+    ///     Task<ofJson> ListenerClass::listenerMethod(const ofJson& params);
+    /// ~~~
+    ///
+    /// The listener method may co_await other Tasks or awaitables such as
+    /// resumeOn(), delay() or resumeOnMainThread() without blocking a server
+    /// thread. The params remain valid
+    /// until the coroutine completes. The value passed to co_return is the
+    /// result of the call and exceptions reject the call.
+    ///
+    /// \note Only available when compiling with C++20 coroutine support.
+    /// \param name The name of the class to be called by the client.
+    /// \param description A JSON description of any information to
+    ///        advertise with this method.  This might include a
+    ///        description of the functionality, the input / output
+    ///        arguments, expected values, etc.
+    /// \param listener A pointer to the listener class.
+    /// \param listenerMethod A pointer to the method to invoke.
+    /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    template <class ListenerClass>
+    void registerMethod(const std::string& name,
+                        const ofJson& description,
+                        ListenerClass* listener,
+                        Task<ofJson> (ListenerClass::*listenerMethod)(const ofJson&),
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Register a coroutine method callback that receives its
+    ///        arguments.
+    ///
+    /// This registers remote methods with the following signature:
+    ///
+    /// ~~~{.cpp}
+    ///     Task<ofJson> ListenerClass::listenerMethod(MethodArgs& args);
+    /// ~~~
+    ///
+    /// The args remain valid until the coroutine completes, so the method
+    /// can check args.cancellationToken between awaits. They refer to
+    /// DetachedServerEvent::sharedArgs() rather than the server event. The
+    /// value passed to co_return is the result of the call, args.result and
+    /// args.error are ignored.
+    ///
+    /// \note Only available when compiling with C++20 coroutine support.
+    /// \param name The name of the class to be called by the client.
+    /// \param description A JSON description of any information to
+    ///        advertise with this method.
+    /// \param listener A pointer to the listener class.
+    /// \param listenerMethod A pointer to the method to invoke.
+    /// \param priority The priority of the event.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    template <class ListenerClass>
+    void registerMethod(const std::string& name,
+                        const ofJson& description,
+                        ListenerClass* listener,
+                        Task<ofJson> (ListenerClass::*listenerMethod)(MethodArgs&),
+                        int priority = OF_EVENT_ORDER_AFTER_APP,
+                        MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                        const CachePolicy& cachePolicy = CachePolicy());
+#endif
 
     /// \brief Unregister a method by name.
     /// \param method is the name of the method callback to be removed.
     /// \note If the given method does not exist, the unregister
     ///        request will be ignored.
+    /// \note Calls to the method that are already in progress are not
+    ///        interrupted and may complete after this function returns.
     void unregisterMethod(const std::string& method);
 
     /// \brief Process a Request.
+    ///
+    /// Method lookup does not take a lock, so calls to any methods may
+    /// execute concurrently from multiple threads. Registered callbacks are
+    /// responsible for their own thread-safety.
+    ///
     /// \param pSender A pointer to the sender.  This might be a pointer
     ///        to a session cookie or WebSocket connection.  While not
     ///        required, this pointer is useful for returning
@@ -151,8 +345,38 @@ public:
     ///        corresponding method callback.
     /// \param request The incoming Request from a client.
     /// \returns A success or error Response.
+    /// \note If the method is a deferred method, or a main thread method
+    ///       called from another thread, this blocks until the call
+    ///       completes.
     Response processCall(const void* pSender, Request& request);
 
+    /// \brief Process a Request asynchronously.
+    ///
+    /// The response handler is called exactly once with the Response. For
+    /// regular methods it is called before this function returns. For
+    /// deferred methods it is called on whichever thread completes the
+    /// DeferredResult, which may be after this function returns. Calls to
+    /// main thread methods from other threads are queued and the handler
+    /// is called on the main thread after the method completes.
+    ///
+    /// If the cancellation token is cancelled before the call completes,
+    /// the handler receives the cancellation error immediately, while the
+    /// method may still be running. If the
+    /// token has a deadline, it is cancelled with
+    /// Errors::RPC_ERROR_DEADLINE_EXCEEDED when the deadline passes. The
+    /// token is cancelled on the registry's completion thread, so the
+    /// handler may be called there.
+    ///
+    /// \param pSender A pointer to the sender.
+    /// \param request The incoming Request from a client.
+    /// \param responseHandler The callback that receives the Response.
+    /// \param cancellationToken The token passed to the method in its
+    ///        MethodArgs.
+    void processCall(const void* pSender,
+                     Request& request,
+                     ResponseHandler responseHandler,
+                     const CancellationToken& cancellationToken = CancellationToken());
+
     /// \brief Process a Request.
     /// \param pSender A pointer to the sender.  This might be a pointer
     ///        to a session cookie or WebSocket connection.  While not
@@ -162,10 +386,135 @@ public:
     ///        responsible for using this sender information in
     ///        corresponding method callback.
     /// \param request The incoming Request from a client.
+    /// \note No Response is created for a notification. Errors raised by
+    ///       the method are logged and otherwise ignored.
     void processNotification(const void* pSender, Request& request);
 
+    /// \brief Queue a notification Request for processing on a ThreadPool.
+    ///
+    /// This returns immediately. The Request is copied into the queued task
+    /// and the method is invoked with DetachedServerEvent::sharedArgs(),
+    /// because the originating server event may no longer be valid.
+    ///
+    /// \param pSender A pointer to the sender.
+    /// \param request The incoming Request from a client.
+    /// \param threadPool The ThreadPool that will process the notification.
+    void processNotification(const void* pSender,
+                             const Request& request,
+                             ThreadPool& threadPool);
+
+    /// \brief Get the result cache statistics of a method.
+    /// \param method The name of the method.
+    /// \returns the statistics, or empty statistics if the method does not
+    ///          exist or does not cache its results.
+    ResultCache::Stats cacheStats(const std::string& method) const;
+
+    /// \brief Remove all cached results of a method.
+    ///
+    /// This can be used when the state that the method's results depend on
+    /// has changed.
+    ///
+    /// \param method The name of the method.
+    void clearCache(const std::string& method);
+
+    /// \brief Limit the number of calls to a method that are in progress at
+    ///        once.
+    ///
+    /// A call is in progress until its method has finished with it, so
+    /// deferred calls hold their slot until they resolve or reject. A
+    /// cancelled call is answered at once but keeps its slot until its
+    /// method returns or completes its DeferredResult. Calls over the
+    /// limit wait in the policy's queue or are rejected with
+    /// Errors::RPC_ERROR_SERVER_BUSY. Calls that time out in the queue are
+    /// rejected on the registry's completion thread. Notifications count
+    /// towards the limit and are dropped when rejected. Cached results are
+    /// returned without counting towards the limit.
+    ///
+    /// The limit is removed if the method is registered again.
+    ///
+    /// \param method The name of the method.
+    /// \param policy The concurrency policy. A disabled policy removes the
+    ///        limit.
+    void setConcurrencyPolicy(const std::string& method,
+                              const ConcurrencyPolicy& policy);
+
+    /// \brief Limit the number of calls to all methods that are in progress
+    ///        at once.
+    ///
+    /// The global limit applies in addition to the limits of each method. A
+    /// call must be admitted by its method's limit before it waits for the
+    /// global limit.
+    ///
+    /// Changing an existing limit keeps its calls in progress and queued
+    /// calls, see ConcurrencyLimiter::setPolicy(), so the limit is never
+    /// exceeded while old calls complete.
+    ///
+    /// \param policy The concurrency policy. A disabled policy removes the
+    ///        limit.
+    void setConcurrencyPolicy(const ConcurrencyPolicy& policy);
+
+    /// \brief Set how queued calls are started once a limit admits them.
+    ///
+    /// Only limits created after this call use the executor.
+    ///
+    /// \param executor Starts admitted calls, or nullptr to start them on
+    ///        the thread that completed the previous call.
+    void setConcurrencyExecutor(ConcurrencyLimiter::Executor executor);
+
+    /// \brief Get the timer used for deadlines and queue timeouts.
+    ///
+    /// Coroutine methods can wait on it with delay().
+    ///
+    /// \returns the Scheduler.
+    Scheduler& scheduler();
+
+    /// \brief Get the queue that runs main thread calls.
+    ///
+    /// Coroutine methods can continue on the main thread with
+    /// resumeOnMainThread().
+    ///
+    /// \returns the MainThreadQueue.
+    MainThreadQueue& mainThreadQueue();
+
+    /// \brief Get the concurrency statistics of a method.
+    /// \param method The name of the method.
+    /// \returns the statistics, or empty statistics if the method does not
+    ///          exist or is not limited.
+    ConcurrencyLimiter::Stats concurrencyStats(const std::string& method) const;
+
+    /// \brief Get the concurrency statistics of the global limit.
+    /// \returns the statistics, or empty statistics if there is no global
+    ///          limit.
+    ConcurrencyLimiter::Stats concurrencyStats() const;
+
+    /// \brief Enable or disable call statistics for all methods.
+    ///
+    /// Disabling statistics discards those recorded so far. Methods that are
+    /// registered while statistics are enabled start with empty statistics.
+    ///
+    /// \param enabled True if calls should be counted and timed.
+    void setStatsEnabled(bool enabled);
+
+    /// \returns true iff call statistics are enabled.
+    bool isStatsEnabled() const;
+
+    /// \brief Get the call statistics of a method.
+    /// \param method The name of the method.
+    /// \returns the statistics, or empty statistics if the method does not
+    ///          exist or statistics are disabled.
+    MethodStats::Snapshot methodStats(const std::string& method) const;
+
+    /// \brief Get the call statistics of all methods.
+    /// \returns the statistics by method name, or an empty map if
+    ///          statistics are disabled.
+    std::map<std::string, MethodStats::Snapshot> methodStats() const;
+
+    /// \brief Discard the call statistics of all methods.
+    void resetMethodStats();
+
     /// \brief Query the registry for the given method.
-    /// \param method the name of the method to find.
+    /// \param method the name of the method to find, with or without
+    ///        arguments.
     /// \returns true iff the given method is in the registry.
     bool hasMethod(const std::string& method) const;
 
@@ -182,25 +531,229 @@ protected:
     /// \brief A shared pointer typedef for no argument methods;
     typedef std::shared_ptr<NoArgMethod> SharedNoArgMethodPtr;
 
-    /// \brief A method map.
-    typedef std::map<std::string, SharedMethodPtr> MethodMap;
+    /// \brief A shared pointer typedef for deferred methods;
+    typedef std::shared_ptr<DeferredMethod> SharedDeferredMethodPtr;
+
+    /// \brief An entry in the method table.
+    ///
+    /// Each entry holds exactly one method pointer, selected by its type.
+    struct MethodEntry
+    {
+        /// \brief The kinds of methods that can be held by an entry.
+        enum class Type
+        {
+            /// \brief A method that accepts MethodArgs.
+            METHOD,
+            /// \brief A method that accepts no arguments.
+            NO_ARG_METHOD,
+            /// \brief A method that accepts DeferredMethodArgs.
+            DEFERRED_METHOD
+        };
+
+        /// \brief The kind of method held by this entry.
+        Type type = Type::METHOD;
+
+        /// \brief The method pointer if type is Type::METHOD.
+        SharedMethodPtr method = nullptr;
+
+        /// \brief The method pointer if type is Type::NO_ARG_METHOD.
+        SharedNoArgMethodPtr noArgMethod = nullptr;
+
+        /// \brief The method pointer if type is Type::DEFERRED_METHOD.
+        SharedDeferredMethodPtr deferredMethod = nullptr;
+
+        /// \brief The thread that the method is invoked on.
+        MethodDispatch dispatch = MethodDispatch::ANY_THREAD;
+
+        /// \brief The cache of the method's results, if enabled.
+        std::shared_ptr<ResultCache> cache = nullptr;
+
+        /// \brief The concurrency limit of the method, if any.
+        std::shared_ptr<ConcurrencyLimiter> limiter = nullptr;
+
+        /// \brief The call statistics of the method, if enabled.
+        std::shared_ptr<MethodStats> stats = nullptr;
+
+        /// \returns the description of the held method.
+        const ofJson& description() const;
+    };
+
+    /// \brief An immutable snapshot of all registered methods.
+    ///
+    /// All methods share a single hash table keyed by method name, so a call
+    /// typically costs one hash and one string comparison regardless of the number of
+    /// registered methods.
+    ///
+    /// A MethodTable is never modified once it has been published. Changes
+    /// to the registry copy the current table, modify the copy and then
+    /// atomically replace the published table.
+    typedef std::unordered_map<std::string, MethodEntry> MethodTable;
+
+    /// \brief A shared pointer typedef for method tables.
+    typedef std::shared_ptr<const MethodTable> SharedMethodTablePtr;
+
+    /// \brief Get the currently published method table.
+    ///
+    /// This does not take the registry mutex and can be called from any
+    /// thread. The returned table remains valid for as long as the caller
+    /// holds on to it, even if methods are registered or unregistered.
+    ///
+    /// \returns the current method table.
+    SharedMethodTablePtr methodTable() const;
+
+    /// \brief Get the statistics of a method to record phases measured
+    ///        outside of the registry.
+    /// \param method The name of the method.
+    /// \returns the statistics, or nullptr if the method does not exist or
+    ///          statistics are disabled.
+    std::shared_ptr<MethodStats> sharedMethodStats(const std::string& method) const;
+
+    /// \brief Publish a method, replacing any method with the same name.
+    /// \param method The method to publish.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    void addMethod(SharedMethodPtr method,
+                   MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                   const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Publish a no argument method, replacing any method with the
+    ///        same name.
+    /// \param method The method to publish.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    void addMethod(SharedNoArgMethodPtr method,
+                   MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                   const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Publish a deferred method, replacing any method with the same
+    ///        name.
+    /// \param method The method to publish.
+    /// \param dispatch The thread that the method is invoked on.
+    /// \param cachePolicy The policy for caching the method's results.
+    void addMethod(SharedDeferredMethodPtr method,
+                   MethodDispatch dispatch = MethodDispatch::ANY_THREAD,
+                   const CachePolicy& cachePolicy = CachePolicy());
+
+    /// \brief Publish a method table entry, replacing any method with the
+    ///        same name.
+    /// \param name The name of the method.
+    /// \param entry The entry to publish.
+    void addMethodEntry(const std::string& name, const MethodEntry& entry);
+
+    /// \brief Admit a call through the concurrency limits and dispatch it.
+    ///
+    /// If the call is rejected, it is completed with
+    /// Errors::RPC_ERROR_SERVER_BUSY.
+    ///
+    /// \param pSender A pointer to the sender.
+    /// \param entry The method table entry to invoke.
+    /// \param request The Request. It is moved if the call may be queued.
+    /// \param responseHandler The callback that receives the Response, or
+    ///        nullptr for notifications.
+    /// \param cancellationToken The token that cancels the call.
+    /// \param callTimer The timer of the call if statistics are enabled,
+    ///        otherwise nullptr.
+    void admitMethod(const void* pSender,
+                     const MethodEntry& entry,
+                     Request& request,
+                     ResponseHandler responseHandler,
+                     const CancellationToken& cancellationToken,
+                     MethodStats::SharedCallTimerPtr callTimer);
+
+    /// \brief Invoke a method on the thread its dispatch requires.
+    ///
+    /// Calls that were cancelled before they started are not invoked.
+    ///
+    /// \param pSender A pointer to the sender.
+    /// \param entry The method table entry to invoke.
+    /// \param request The Request.
+    /// \param deferredResult The result that completes the call.
+    /// \param callTimer The timer of the call, or nullptr.
+    void dispatchMethod(const void* pSender,
+                        const MethodEntry& entry,
+                        Request& request,
+                        const DeferredResult& deferredResult,
+                        MethodStats::SharedCallTimerPtr callTimer);
+
+    /// \brief Invoke a method and complete its DeferredResult.
+    ///
+    /// Exceptions thrown by the method reject the call.
+    ///
+    /// \param pSender A pointer to the sender.
+    /// \param entry The method table entry to invoke.
+    /// \param request The Request. Its parameters are moved to the method.
+    /// \param deferredResult The result that completes the call.
+    /// \param callTimer The timer of the call, or nullptr.
+    void invokeMethod(const void* pSender,
+                      const MethodEntry& entry,
+                      Request& request,
+                      const DeferredResult& deferredResult,
+                      MethodStats::SharedCallTimerPtr callTimer);
+
+    /// \brief Queue a method invocation on the main thread.
+    /// \param pSender A pointer to the sender.
+    /// \param entry The method table entry to invoke.
+    /// \param request The Request. It is moved into the queued call.
+    /// \param deferredResult The result that completes the call.
+    /// \param callTimer The timer of the call, or nullptr.
+    void queueMethod(const void* pSender,
+                     const MethodEntry& entry,
+                     Request& request,
+                     const DeferredResult& deferredResult,
+                     MethodStats::SharedCallTimerPtr callTimer);
+
+    /// \brief The queue of calls to main thread methods.
+    MainThreadQueue _mainThreadQueue;
+
+    /// \brief Move a Request into a copy that can be queued.
+    ///
+    /// The copy refers to DetachedServerEvent::sharedArgs() instead of the
+    /// server event of the Request, which may be gone before it is invoked.
+    /// The connection, connection id and received time are kept.
+    ///
+    /// \param request The Request. Its parameters are moved from.
+    /// \returns the queued copy.
+    static std::shared_ptr<Request> detachRequest(Request& request);
+
+    /// \brief Get an executor that runs functions on the completion thread.
+    ///
+    /// Deadlines and queue timeouts fire on the Scheduler's timer thread.
+    /// The calls they complete are answered, and the next queued calls
+    /// started, on the completion thread instead.
+    ///
+    /// \returns the executor.
+    ConcurrencyLimiter::Executor completionExecutor();
+
+    /// \brief The timer shared by the concurrency limits.
+    std::shared_ptr<Scheduler> _scheduler;
 
-    /// \brief A void no argument method map.
-    typedef std::map<std::string, SharedNoArgMethodPtr> NoArgMethodMap;
+    /// \brief The completion thread, created when it is first needed.
+    std::shared_ptr<ThreadPool> _completionThread;
 
-    /// \brief A method map iterator.
-    typedef MethodMap::iterator MethodMapIter;
+    /// \brief Creates the completion thread once.
+    std::once_flag _completionThreadFlag;
 
-    /// \brief A no argument method map iterator.
-    typedef NoArgMethodMap::iterator NoArgMethodMapIter;
+    /// \brief Starts queued calls admitted by new concurrency limits.
+    ConcurrencyLimiter::Executor _concurrencyExecutor;
 
-    /// \brief Maps method names to their method pointers.
-    MethodMap _methodMap;
+    /// \brief The global concurrency limit, if any.
+    ///
+    /// This must only be accessed with std::atomic_load and
+    /// std::atomic_store.
+    std::shared_ptr<ConcurrencyLimiter> _concurrencyLimiter;
+
+    /// \brief True if call statistics are enabled.
+    std::atomic<bool> _isStatsEnabled;
 
-    /// \brief Maps no argument method names to their method pointers.
-    NoArgMethodMap _noArgMethodMap;
+    /// \brief The currently published method table.
+    ///
+    /// This must only be accessed with std::atomic_load and
+    /// std::atomic_store.
+    SharedMethodTablePtr _methodTable;
 
-    /// \brief A mutext to ensure method map validity.
+    /// \brief A mutex to serialize changes to the method table.
+    ///
+    /// Readers never take this mutex.
     mutable std::mutex _mutex;
 
 };
@@ -211,13 +764,13 @@ void MethodRegistry::registerMethod(const std::string& name,
                                     const ofJson& description,
                                     ListenerClass* listener,
                                     void (ListenerClass::*listenerMethod)(const void*, MethodArgs&),
-                                    int priority)
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
 {
-    unregisterMethod(name);
-
-    std::unique_lock<std::mutex> lock(_mutex);
-    _methodMap[name] = SharedMethodPtr(new Method(name, description));
-    _methodMap[name]->event.add(listener, listenerMethod, priority);
+    SharedMethodPtr method = std::make_shared<Method>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
 }
 
 template <class ListenerClass>
@@ -225,13 +778,13 @@ void MethodRegistry::registerMethod(const std::string& name,
                                     const ofJson& description,
                                     ListenerClass* listener,
                                     void (ListenerClass::*listenerMethod)(MethodArgs&),
-                                    int priority)
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
 {
-    unregisterMethod(name);
-
-    std::unique_lock<std::mutex> lock(_mutex);
-    _methodMap[name] = SharedMethodPtr(new Method(name, description));
-    _methodMap[name]->event.add(listener, listenerMethod, priority);
+    SharedMethodPtr method = std::make_shared<Method>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
 }
 
 template <class ListenerClass>
@@ -239,13 +792,13 @@ void MethodRegistry::registerMethod(const std::string& name,
                                     const ofJson& description,
                                     ListenerClass* listener,
                                     void (ListenerClass::*listenerMethod)(const void*),
-                                    int priority)
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
 {
-    unregisterMethod(name);
-
-    std::unique_lock<std::mutex> lock(_mutex);
-    _noArgMethodMap[name] = SharedNoArgMethodPtr(new NoArgMethod(name, description));
-    _noArgMethodMap[name]->event.add(listener, listenerMethod, priority);
+    SharedNoArgMethodPtr method = std::make_shared<NoArgMethod>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
 }
 
 template <class ListenerClass>
@@ -253,14 +806,81 @@ void MethodRegistry::registerMethod(const std::string& name,
                                     const ofJson& description,
                                     ListenerClass* listener,
                                     void (ListenerClass::*listenerMethod)(void),
-                                    int priority)
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
 {
-    unregisterMethod(name);
+    SharedNoArgMethodPtr method = std::make_shared<NoArgMethod>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
+}
 
-    std::unique_lock<std::mutex> lock(_mutex);
-    _noArgMethodMap[name] = SharedNoArgMethodPtr(new NoArgMethod(name, description));
-    _noArgMethodMap[name]->event.add(listener, listenerMethod, priority);
+template <class ListenerClass>
+void MethodRegistry::registerMethod(const std::string& name,
+                                    const ofJson& description,
+                                    ListenerClass* listener,
+                                    void (ListenerClass::*listenerMethod)(const void*, DeferredMethodArgs&),
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
+{
+    SharedDeferredMethodPtr method = std::make_shared<DeferredMethod>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
+}
+
+template <class ListenerClass>
+void MethodRegistry::registerMethod(const std::string& name,
+                                    const ofJson& description,
+                                    ListenerClass* listener,
+                                    void (ListenerClass::*listenerMethod)(DeferredMethodArgs&),
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
+{
+    SharedDeferredMethodPtr method = std::make_shared<DeferredMethod>(name, description);
+    method->event.add(listener, listenerMethod, priority);
+    addMethod(method, dispatch, cachePolicy);
+}
+
+#if OFX_JSONRPC_HAS_COROUTINES
+template <class ListenerClass>
+void MethodRegistry::registerMethod(const std::string& name,
+                                    const ofJson& description,
+                                    ListenerClass* listener,
+                                    Task<ofJson> (ListenerClass::*listenerMethod)(const ofJson&),
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
+{
+    addMethod(SharedDeferredMethodPtr(std::make_shared<CoroutineMethod_<ListenerClass>>(name,
+                                                                                         description,
+                                                                                         listener,
+                                                                                         listenerMethod,
+                                                                                         priority)),
+              dispatch,
+              cachePolicy);
+}
+
+
+template <class ListenerClass>
+void MethodRegistry::registerMethod(const std::string& name,
+                                    const ofJson& description,
+                                    ListenerClass* listener,
+                                    Task<ofJson> (ListenerClass::*listenerMethod)(MethodArgs&),
+                                    int priority,
+                                    MethodDispatch dispatch,
+                                    const CachePolicy& cachePolicy)
+{
+    addMethod(SharedDeferredMethodPtr(std::make_shared<CoroutineMethod_<ListenerClass>>(name,
+                                                                                         description,
+                                                                                         listener,
+                                                                                         listenerMethod,
+                                                                                         priority)),
+              dispatch,
+              cachePolicy);
 }
+#endif
 
 
 } } // namespace ofx::JSONRPC
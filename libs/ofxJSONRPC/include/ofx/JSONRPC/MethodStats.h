@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ofJson.h"
+#include "ofx/JSONRPC/LatencyHistogram.h"
+#include "ofx/JSONRPC/Response.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief Call counts and latency histograms for one method.
+///
+/// The latency of each call is recorded separately for each Phase. Counts
+/// and latencies are recorded without a lock, except for error counts,
+/// which are only recorded for failed calls.
+class MethodStats
+{
+public:
+    /// \brief A typedef for the clock used to measure latencies.
+    typedef std::chrono::steady_clock Clock;
+
+    /// \brief The phases of a call.
+    enum class Phase
+    {
+        /// \brief Decoding the request.
+        PARSE,
+        /// \brief Waiting for the method to be invoked.
+        ///
+        /// This starts when the request was received, see
+        /// Request::setReceivedTime(), less the parse phase, so time spent
+        /// in a connection's frame queue is included.
+        QUEUE,
+        /// \brief Invoking the method until its result is complete.
+        HANDLER,
+        /// \brief Encoding the response.
+        SERIALIZE,
+        /// \brief Passing the response to the connection.
+        ///
+        /// This is the time until the response is handed on, not until it
+        /// is written to the socket. For elements of a batch it only covers
+        /// storing the response in the batch, except for the last element
+        /// to complete, which also sends the batch. Coalesced responses only
+        /// measure adding the response to the held back frame.
+        SEND
+    };
+
+    /// \brief The number of phases.
+    static const std::size_t NUM_PHASES = 5;
+
+    /// \brief A copy of the statistics at one point in time.
+    struct Snapshot
+    {
+        /// \brief The number of completed calls.
+        uint64_t numCalls = 0;
+
+        /// \brief The number of notifications.
+        uint64_t numNotifications = 0;
+
+        /// \brief The number of calls in progress.
+        uint64_t numActiveCalls = 0;
+
+        /// \brief The number of calls completed with an error.
+        uint64_t numErrors = 0;
+
+        /// \brief The number of calls completed with each error code.
+        std::map<int, uint64_t> numErrorsByCode;
+
+        /// \brief The latencies of each phase in microseconds.
+        std::array<LatencyHistogram::Snapshot, NUM_PHASES> phases;
+
+        /// \brief The time since the statistics were created or reset.
+        std::chrono::microseconds elapsedTime = std::chrono::microseconds(0);
+
+        /// \brief Serialize a Snapshot as a JSON object.
+        ///
+        /// Along with the counts, the object contains the number of calls
+        /// per second and the latencies of each phase by name.
+        ///
+        /// \param snapshot The Snapshot to serialize.
+        /// \returns the JSON object.
+        static ofJson toJSON(const Snapshot& snapshot);
+    };
+
+    /// \brief Records the queue and handler phases of one call.
+    class CallTimer
+    {
+    public:
+        /// \brief Create a CallTimer for a call.
+        ///
+        /// The call is counted as in progress until it is completed.
+        ///
+        /// \param stats The statistics of the called method.
+        /// \param receivedTime The time the call was received, or a default
+        ///        time point if it was received just now.
+        CallTimer(std::shared_ptr<MethodStats> stats,
+                  Clock::time_point receivedTime = Clock::time_point());
+
+        /// \brief Record the end of the queue phase.
+        ///
+        /// This is called just before the method is invoked.
+        void start();
+
+        /// \brief Record the outcome of the call.
+        ///
+        /// A call may be answered before its method has finished, e.g. when
+        /// it is cancelled, so the outcome is recorded by complete().
+        ///
+        /// \param response The Response of the call.
+        void respond(const Response& response);
+
+        /// \brief Record the end of the handler phase and the outcome.
+        ///
+        /// This is called once the method has finished with the call.
+        void complete();
+
+    private:
+        /// \brief The statistics of the called method.
+        std::shared_ptr<MethodStats> _stats;
+
+        /// \brief The time the call was received.
+        Clock::time_point _receivedTime;
+
+        /// \brief The time the method was invoked, or the minimum if it was
+        ///        not invoked.
+        std::atomic<Clock::rep> _startTime;
+
+        /// \brief The error code of the Response of the call.
+        std::atomic<int> _errorCode;
+
+    };
+
+    /// \brief A shared pointer to a CallTimer.
+    typedef std::shared_ptr<CallTimer> SharedCallTimerPtr;
+
+    /// \brief Create empty MethodStats.
+    MethodStats();
+
+    /// \brief Destroy the MethodStats.
+    virtual ~MethodStats();
+
+    /// \brief Record the latency of a phase.
+    /// \param phase The phase.
+    /// \param duration The time spent in the phase.
+    void record(Phase phase, Clock::duration duration);
+
+    /// \brief Record a completed call.
+    /// \param errorCode The error code, or Errors::RPC_ERROR_NONE.
+    void recordCall(int errorCode);
+
+    /// \brief Record a notification.
+    void recordNotification();
+
+    /// \returns a copy of the statistics.
+    Snapshot snapshot() const;
+
+    /// \brief Remove all recorded statistics.
+    ///
+    /// Calls in progress are still counted.
+    void reset();
+
+    /// \brief Get the name of a phase.
+    /// \param phase The phase.
+    /// \returns the lower case name of the phase, e.g. "handler".
+    static std::string toString(Phase phase);
+
+private:
+    /// \brief The latencies of each phase.
+    std::array<LatencyHistogram, NUM_PHASES> _phases;
+
+    /// \brief The number of completed calls.
+    std::atomic<uint64_t> _numCalls;
+
+    /// \brief The number of notifications.
+    std::atomic<uint64_t> _numNotifications;
+
+    /// \brief The number of calls in progress.
+    std::atomic<uint64_t> _numActiveCalls;
+
+    /// \brief The number of calls completed with an error.
+    std::atomic<uint64_t> _numErrors;
+
+    /// \brief The number of calls completed with each error code.
+    std::map<int, uint64_t> _numErrorsByCode;
+
+    /// \brief The time the statistics were created or reset.
+    std::atomic<Clock::rep> _startTime;
+
+    /// \brief The mutex protecting the error counts.
+    mutable std::mutex _mutex;
+
+};
+
+
+} } // namespace ofx::JSONRPC
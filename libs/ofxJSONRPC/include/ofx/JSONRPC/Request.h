@@ -8,6 +8,7 @@
 #pragma once
 
 
+#include <chrono>
 #include <string>
 #include <map>
 #include "json.hpp"
@@ -16,6 +17,15 @@
 
 
 namespace ofx {
+namespace HTTP {
+
+
+class WebSocketConnection;
+
+
+} // namespace HTTP
+
+
 namespace JSONRPC {
 
 
@@ -52,6 +62,14 @@ public:
     Request(HTTP::ServerEventArgs& evt,
             const std::string& method, const ofJson& parameters);
 
+    /// \brief Create a notification Request, taking ownership of the
+    ///        parameters.
+    /// \param evt The originating server event.
+    /// \param method The method's name.
+    /// \param parameters The parameters to pass to the method.
+    Request(HTTP::ServerEventArgs& evt,
+            const std::string& method, ofJson&& parameters);
+
     /// \brief Create a Request.
     /// \param evt The originating server event.
     /// \param id The transatction identification number.
@@ -69,6 +87,16 @@ public:
             const std::string& method,
             const ofJson& parameters);
 
+    /// \brief Create a Request, taking ownership of the id and parameters.
+    /// \param evt The originating server event.
+    /// \param id The transatction identification number.
+    /// \param method The method's name.
+    /// \param parameters The parameters to pass to the method.
+    Request(HTTP::ServerEventArgs& evt,
+            ofJson&& id,
+            const std::string& method,
+            ofJson&& parameters);
+
     /// \brief Destroy the ErrorResponse.
     virtual ~Request();
 
@@ -80,12 +108,49 @@ public:
     /// \brief Get the request parameters.
     /// \returns the request method parameters.
     const ofJson& parameters() const;
+
+    /// \brief Get the request parameters.
+    ///
+    /// The parameters may be moved from, e.g. to pass them to a method
+    /// without copying them.
+    ///
+    /// \returns the request method parameters.
+    ofJson& parameters();
     OF_DEPRECATED_MSG("Use parameters() instead.", const ofJson& getParameters() const);
 
     /// \brief Query whether this Request is a notification.
     /// \returns true iff the id is null.
     bool isNotification() const;
 
+    /// \brief Set the WebSocket connection that sent this Request.
+    /// \param connection The connection, or nullptr if the Request was not
+    ///        sent over a WebSocket connection.
+    /// \param connectionId The id that identifies the connection among all
+    ///        connections of the server, or 0 if there is no connection.
+    void setConnection(const HTTP::WebSocketConnection* connection,
+                       uint64_t connectionId);
+
+    /// \brief Get the WebSocket connection that sent this Request.
+    /// \returns the connection, or nullptr if the Request was not sent over
+    ///          a WebSocket connection.
+    const HTTP::WebSocketConnection* connection() const;
+
+    /// \brief Get the id of the WebSocket connection that sent this Request.
+    /// \returns the id of the connection, or 0 if there is no connection.
+    uint64_t connectionId() const;
+
+    /// \brief Set the time this Request was received.
+    ///
+    /// The queue phase of the call's statistics starts at this time, so
+    /// that time spent waiting before the Request was processed is counted.
+    ///
+    /// \param receivedTime The time the Request was received.
+    void setReceivedTime(std::chrono::steady_clock::time_point receivedTime);
+
+    /// \brief Get the time this Request was received.
+    /// \returns the time, or a default time point if it was not set.
+    std::chrono::steady_clock::time_point receivedTime() const;
+
     /// \brief Get the JSON Request as a string.
     /// \param styled true if the output string should be pretty-print.
     /// \returns a raw json string of this Request
@@ -96,12 +161,34 @@ public:
     /// \returns JSONRPC compatible JSON.
     static ofJson toJSON(const Request& request);
 
+    /// \brief Create the JSON for a notification.
+    ///
+    /// This is useful for sending notifications to clients, e.g. from a
+    /// server, where there is no originating server event.
+    ///
+    /// \param method The name of the method to notify.
+    /// \param params The parameters of the notification. If null, the
+    ///        params are omitted.
+    /// \returns JSONRPC compatible JSON.
+    static ofJson notificationToJSON(const std::string& method,
+                                     const ofJson& params = nullptr);
+
     /// \brief Deserialize the JSON to a Request object.
     /// \param json JSONRPC compatible JSON to deserialize.
     /// \returns deserialized Request.
     /// \throws ParseException if the json is not valid.
     static Request fromJSON(HTTP::ServerEventArgs& evt, const ofJson& json);
 
+    /// \brief Deserialize the JSON to a Request object.
+    ///
+    /// The id and parameters are moved out of the json rather than copied.
+    ///
+    /// \param json JSONRPC compatible JSON to deserialize.
+    /// \returns deserialized Request.
+    /// \throws ParseException if the json is not valid. The json is left
+    ///         unmodified if an exception is thrown.
+    static Request fromJSON(HTTP::ServerEventArgs& evt, ofJson&& json);
+
 protected:
     /// \brief The method name.
     std::string _method;
@@ -109,6 +196,15 @@ protected:
     /// \brief The method parameters.
     ofJson _parameters;
 
+    /// \brief The WebSocket connection that sent this Request, if any.
+    const HTTP::WebSocketConnection* _connection = nullptr;
+
+    /// \brief The id of the WebSocket connection, or 0.
+    uint64_t _connectionId = 0;
+
+    /// \brief The time this Request was received, if set.
+    std::chrono::steady_clock::time_point _receivedTime;
+
     /// \brief Method tag.
     static const std::string METHOD_TAG;
 
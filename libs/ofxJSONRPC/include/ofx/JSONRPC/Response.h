@@ -8,9 +8,13 @@
 #pragma once
 
 
-#include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
 #include "json.hpp"
+#include "ofx/JSONRPC/Encoding.h"
 #include "ofx/JSONRPC/Error.h"
 #include "ofx/JSONRPC/BaseMessage.h"
 
@@ -35,6 +39,9 @@ namespace JSONRPC {
 class Response: public BaseMessage
 {
 public:
+    /// \brief A shared, immutable result that is already serialized as JSON.
+    typedef std::shared_ptr<const std::string> SerializedResult;
+
     /// \brief Create a default Error Response.
     Response(HTTP::ServerEventArgs& evt);
 
@@ -59,6 +66,8 @@ public:
     /// \brief Get the Result JSON if available.
     /// \returns result JSON data if available.
     /// \note The JSON data will be empty if there is an error.
+    /// \note If the Response was created with a serialized result, it is
+    ///       parsed once, the first time it is accessed from any thread.
     const ofJson& result() const;
     OF_DEPRECATED_MSG("Use result() instead.", const ofJson& getResult() const);
 
@@ -70,6 +79,11 @@ public:
     const Error& error() const;
     OF_DEPRECATED_MSG("Use error() instead.", const Error& getError() const);
 
+    /// \brief Get the serialized result if available.
+    /// \returns the serialized result or nullptr if the Response was not
+    ///          created with a serialized result.
+    SerializedResult serializedResult() const;
+
     /// \brief Query if the Response is an error response.
     /// \returns true iff an error code is present.
     bool isErrorResponse() const;
@@ -79,6 +93,52 @@ public:
     /// \returns a raw json string of this Response
     std::string toString(bool styled = false) const;
 
+    /// \brief Write the serialized Response to a stream.
+    ///
+    /// The envelope is written directly to the stream and the id, result and
+    /// error are serialized in place, without first building a JSON copy of
+    /// the whole Response.
+    ///
+    /// \param stream The stream to write to.
+    void write(std::ostream& stream) const;
+
+    /// \brief Append the serialized Response to a buffer.
+    ///
+    /// The buffer is not cleared, so it may be reused across Responses or
+    /// contain other data, e.g. the enclosing array of a batch response.
+    ///
+    /// \param buffer The buffer to append to.
+    void write(std::string& buffer) const;
+
+    /// \brief Append the Response to a buffer in the given encoding.
+    /// \param buffer The buffer to append to.
+    /// \param encoding The encoding to write.
+    void write(std::string& buffer, Encoding encoding) const;
+
+    /// \brief Create a successful Response with a serialized result.
+    ///
+    /// The serialized result is written verbatim when the Response is
+    /// serialized as JSON, so it is not serialized again.
+    ///
+    /// \param evt The originating server event.
+    /// \param id The id of the original remote call.
+    /// \param serializedResult The results of the function call, already
+    ///        serialized as JSON text.
+    /// \returns the Response.
+    static Response fromSerialized(HTTP::ServerEventArgs& evt,
+                                   const ofJson& id,
+                                   SerializedResult serializedResult);
+
+    /// \brief Serialize a result once so that it can be reused.
+    ///
+    /// A serialized result can be shared by any number of Responses, e.g.
+    /// for a constant or frequently requested result. Only the envelope and
+    /// id are written for each Response.
+    ///
+    /// \param result The result to serialize.
+    /// \returns the serialized result.
+    static SerializedResult serializeResult(const ofJson& result);
+
     /// \brief Serialize the Response object to JSON.
     /// \param response the Response object to serialize.
     /// \returns JSONRPC compatible JSON.
@@ -91,9 +151,26 @@ public:
     static Response fromJSON(HTTP::ServerEventArgs& evt, const ofJson& json);
 
 protected:
+    /// \brief A serialized result parsed on first access.
+    struct ParsedResult
+    {
+        /// \brief The flag that ensures the result is parsed only once.
+        std::once_flag flag;
+
+        /// \brief The parsed result.
+        ofJson result;
+    };
+
     /// \brief The result of the remote call.
     ofJson _result;
 
+    /// \brief The serialized result of the remote call, if available.
+    SerializedResult _serializedResult;
+
+    /// \brief The parsed serialized result, shared by copies of the
+    ///        Response. Set iff there is a serialized result.
+    std::shared_ptr<ParsedResult> _parsedResult;
+
     /// \brief An Error object.  Will be empty if there is no error.
     Error _error;
 
@@ -103,6 +180,12 @@ protected:
     /// \brief Result tag.
     static const std::string RESULT_TAG;
 
+    /// \brief The envelope written before a successful result.
+    static const std::string RESULT_PREFIX;
+
+    /// \brief The envelope written between a result or error and the id.
+    static const std::string ID_PREFIX;
+
 };
 
 
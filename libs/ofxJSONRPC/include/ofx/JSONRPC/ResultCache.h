@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ofJson.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief Settings for caching the results of an idempotent method.
+///
+/// Caching is disabled unless the time to live is greater than zero.
+struct CachePolicy
+{
+    /// \brief How long a cached result may be returned after it was created.
+    std::chrono::milliseconds timeToLive = std::chrono::milliseconds(0);
+
+    /// \brief The maximum number of cached results.
+    ///
+    /// When the cache is full, the least recently used result is evicted.
+    std::size_t maxEntries = 128;
+
+    /// \returns true iff results should be cached.
+    bool isEnabled() const
+    {
+        return timeToLive.count() > 0 && maxEntries > 0;
+    }
+};
+
+
+/// \brief A thread-safe cache of serialized method results.
+///
+/// Results are keyed by the canonical serialization of the call's
+/// parameters. Object keys are always serialized in sorted order, so
+/// parameters that differ only in key order share a cached result.
+///
+/// Only the serialized result is cached, so a hit can be sent without
+/// invoking the method or serializing its result again.
+class ResultCache
+{
+public:
+    /// \brief A shared pointer to a serialized result.
+    typedef std::shared_ptr<const std::string> SerializedResult;
+
+    /// \brief Cache statistics, used to tune a CachePolicy.
+    struct Stats
+    {
+        /// \brief The number of lookups that returned a cached result.
+        uint64_t numHits = 0;
+
+        /// \brief The number of lookups that did not find a valid result.
+        uint64_t numMisses = 0;
+
+        /// \brief The number of results currently cached.
+        std::size_t numEntries = 0;
+    };
+
+    /// \brief Create a ResultCache.
+    /// \param policy The caching policy.
+    ResultCache(const CachePolicy& policy);
+
+    /// \brief Destroy the ResultCache.
+    virtual ~ResultCache();
+
+    /// \brief Create the cache key for a call.
+    /// \param params The parameters of the call.
+    /// \returns the key.
+    static std::string key(const ofJson& params);
+
+    /// \brief Look up a cached result.
+    /// \param key The key created by key().
+    /// \returns the serialized result or nullptr if there is no valid
+    ///          result for the key.
+    SerializedResult get(const std::string& key);
+
+    /// \brief Cache a result.
+    /// \param key The key created by key().
+    /// \param result The result to cache.
+    /// \returns the serialized result.
+    SerializedResult put(const std::string& key, const ofJson& result);
+
+    /// \brief Cache a result that is already serialized.
+    /// \param key The key created by key().
+    /// \param serializedResult The serialized result to cache.
+    /// \returns the serialized result.
+    SerializedResult put(const std::string& key, SerializedResult serializedResult);
+
+    /// \brief Remove all cached results.
+    void clear();
+
+    /// \returns the current statistics.
+    Stats stats() const;
+
+    /// \returns the caching policy.
+    const CachePolicy& policy() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// \brief The list of keys, from most to least recently used.
+    typedef std::list<std::string> KeyList;
+
+    /// \brief A cached result.
+    struct Entry
+    {
+        /// \brief The serialized result.
+        SerializedResult result;
+
+        /// \brief The time after which the result is no longer valid.
+        Clock::time_point expires;
+
+        /// \brief The position of the key in the usage list.
+        KeyList::iterator usage;
+    };
+
+    /// \brief The caching policy.
+    CachePolicy _policy;
+
+    /// \brief The cached results by key.
+    std::unordered_map<std::string, Entry> _entries;
+
+    /// \brief The keys, from most to least recently used.
+    KeyList _usage;
+
+    /// \brief The number of hits.
+    std::atomic<uint64_t> _numHits;
+
+    /// \brief The number of misses.
+    std::atomic<uint64_t> _numMisses;
+
+    /// \brief The mutex protecting the entries.
+    mutable std::mutex _mutex;
+
+};
+
+
+} } // namespace ofx::JSONRPC
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief Runs tasks after a delay on a single timer thread.
+///
+/// The timer thread is started when the first task is scheduled. Tasks run
+/// on the timer thread in the order of their due times and should return
+/// quickly, e.g. by submitting longer work to a ThreadPool.
+class Scheduler
+{
+public:
+    /// \brief A typedef for a task.
+    typedef std::function<void()> Task;
+
+    /// \brief A typedef for the identifier of a scheduled task.
+    typedef uint64_t TaskId;
+
+    /// \brief A typedef for the clock used for due times.
+    typedef std::chrono::steady_clock Clock;
+
+    /// \brief Create a Scheduler.
+    Scheduler();
+
+    /// \brief Destroy the Scheduler.
+    ///
+    /// Tasks that are not yet due are discarded. If a task is running, it
+    /// completes before the timer thread is joined.
+    virtual ~Scheduler();
+
+    /// \brief Schedule a task.
+    /// \param delay The time to wait before running the task.
+    /// \param task The task to run. The task must not throw.
+    /// \returns the identifier of the task, which can be used to cancel it.
+    TaskId schedule(std::chrono::microseconds delay, Task task);
+
+    /// \brief Cancel a scheduled task.
+    /// \param taskId The identifier returned by schedule().
+    /// \returns true iff the task had not yet started and was discarded.
+    bool cancel(TaskId taskId);
+
+    /// \returns the number of tasks that are not yet due.
+    std::size_t numScheduledTasks() const;
+
+private:
+    /// \brief The timer thread loop.
+    void _run();
+
+    /// \brief The due times of the scheduled tasks, in order.
+    std::set<std::pair<Clock::time_point, TaskId>> _dueTimes;
+
+    /// \brief The scheduled tasks and their due times by identifier.
+    std::map<TaskId, std::pair<Clock::time_point, Task>> _tasks;
+
+    /// \brief The identifier of the next scheduled task.
+    TaskId _nextTaskId = 1;
+
+    /// \brief The timer thread.
+    std::thread _thread;
+
+    /// \brief True until the Scheduler is being destroyed.
+    bool _isRunning = true;
+
+    /// \brief The mutex protecting the scheduled tasks.
+    mutable std::mutex _mutex;
+
+    /// \brief Signals the timer thread when the earliest due time changes.
+    std::condition_variable _condition;
+
+};
+
+
+} } // namespace ofx::JSONRPC
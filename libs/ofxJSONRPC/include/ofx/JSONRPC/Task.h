@@ -0,0 +1,513 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define OFX_JSONRPC_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifndef OFX_JSONRPC_HAS_COROUTINES
+#define OFX_JSONRPC_HAS_COROUTINES 0
+#endif
+
+
+#if OFX_JSONRPC_HAS_COROUTINES
+
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include "ofJson.h"
+#include "ofThread.h"
+#include "ofx/JSONRPC/DeferredResult.h"
+#include "ofx/JSONRPC/DetachedServerEvent.h"
+#include "ofx/JSONRPC/Errors.h"
+#include "ofx/JSONRPC/MainThreadQueue.h"
+#include "ofx/JSONRPC/Method.h"
+#include "ofx/JSONRPC/MethodArgs.h"
+#include "ofx/JSONRPC/Scheduler.h"
+#include "ofx/JSONRPC/ThreadPool.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+template <typename T>
+class Task;
+
+
+namespace Detail {
+
+
+/// \brief The promise state shared by all Task types.
+class TaskPromiseBase
+{
+public:
+    /// \brief Resumes the awaiting coroutine when a Task finishes.
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename PromiseType>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> handle) noexcept
+        {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    /// \brief Tasks are lazy and start when they are awaited.
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    /// \brief The coroutine awaiting this Task.
+    std::coroutine_handle<> continuation = nullptr;
+
+    /// \brief An exception thrown by the Task, if any.
+    std::exception_ptr exception = nullptr;
+};
+
+
+template <typename T>
+class TaskPromise: public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    void return_value(T value)
+    {
+        result = std::move(value);
+    }
+
+    T takeResult()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+
+template <>
+class TaskPromise<void>: public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept
+    {
+    }
+
+    void takeResult()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+
+/// \brief A coroutine that starts immediately and destroys itself when done.
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+
+} // namespace Detail
+
+
+/// \brief An awaitable task returned by coroutine methods.
+///
+/// A Task is lazy. Its coroutine starts running when the Task is awaited and
+/// the awaiting coroutine is resumed, on the same thread, when the Task
+/// finishes. Exceptions thrown by the Task are rethrown to the awaiter.
+///
+/// ~~~{.cpp}
+///     JSONRPC::Task<ofJson> ofApp::readFile(const ofJson& params)
+///     {
+///         // Continue on a worker thread, freeing the server thread.
+///         co_await JSONRPC::resumeOn(server.threadPool());
+///         co_return ofBufferFromFile(params["path"]).getText();
+///     }
+/// ~~~
+///
+/// \tparam T The type of the Task's result.
+template <typename T>
+class Task
+{
+public:
+    typedef Detail::TaskPromise<T> promise_type;
+
+    Task(Task&& other) noexcept:
+        _handle(std::exchange(other._handle, nullptr))
+    {
+    }
+
+    Task(const Task&) = delete;
+    Task& operator = (const Task&) = delete;
+
+    ~Task()
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+    {
+        _handle.promise().continuation = continuation;
+        return _handle;
+    }
+
+    T await_resume()
+    {
+        return _handle.promise().takeResult();
+    }
+
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept:
+        _handle(handle)
+    {
+    }
+
+    /// \brief The coroutine handle owned by this Task.
+    std::coroutine_handle<promise_type> _handle;
+
+};
+
+
+/// \brief An awaitable that resumes the awaiting coroutine on a ThreadPool.
+class ThreadPoolAwaiter
+{
+public:
+    explicit ThreadPoolAwaiter(ThreadPool& threadPool):
+        _threadPool(threadPool)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        _threadPool.submit([handle]() { handle.resume(); });
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    ThreadPool& _threadPool;
+
+};
+
+
+/// \brief Continue the current coroutine on one of the pool's worker threads.
+/// \param threadPool The ThreadPool to continue on.
+/// \returns an awaitable.
+inline ThreadPoolAwaiter resumeOn(ThreadPool& threadPool)
+{
+    return ThreadPoolAwaiter(threadPool);
+}
+
+
+/// \brief An awaitable that resumes the awaiting coroutine after a delay.
+class DelayAwaiter
+{
+public:
+    DelayAwaiter(Scheduler& scheduler,
+                 std::chrono::microseconds duration,
+                 ThreadPool& threadPool):
+        _scheduler(scheduler),
+        _duration(duration),
+        _threadPool(threadPool)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // Tasks on the timer thread must return quickly, so the coroutine
+        // continues on the pool.
+        ThreadPool& threadPool = _threadPool;
+
+        _scheduler.schedule(_duration, [&threadPool, handle]() {
+            threadPool.submit([handle]() { handle.resume(); });
+        });
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    Scheduler& _scheduler;
+
+    std::chrono::microseconds _duration;
+
+    ThreadPool& _threadPool;
+
+};
+
+
+/// \brief Continue the current coroutine after a delay without blocking.
+///
+/// ~~~{.cpp}
+///     co_await JSONRPC::delay(server.scheduler(),
+///                             std::chrono::milliseconds(100),
+///                             server.threadPool());
+/// ~~~
+///
+/// \param scheduler The Scheduler that times the delay.
+/// \param duration The time to wait.
+/// \param threadPool The ThreadPool to continue on once the delay passes.
+/// \returns an awaitable.
+inline DelayAwaiter delay(Scheduler& scheduler,
+                          std::chrono::microseconds duration,
+                          ThreadPool& threadPool)
+{
+    return DelayAwaiter(scheduler, duration, threadPool);
+}
+
+
+/// \brief An awaitable that resumes the awaiting coroutine on the main
+///        thread.
+class MainThreadAwaiter
+{
+public:
+    explicit MainThreadAwaiter(MainThreadQueue& mainThreadQueue):
+        _mainThreadQueue(mainThreadQueue)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return ofThread::isMainThread();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        _mainThreadQueue.submit([handle]() { handle.resume(); });
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    MainThreadQueue& _mainThreadQueue;
+
+};
+
+
+/// \brief Continue the current coroutine on the main thread.
+///
+/// The coroutine continues during the next ofEvents().update, so the queue
+/// must be started. If the coroutine is already on the main thread, it
+/// continues immediately.
+///
+/// \param mainThreadQueue The queue drained on the main thread.
+/// \returns an awaitable.
+inline MainThreadAwaiter resumeOnMainThread(MainThreadQueue& mainThreadQueue)
+{
+    return MainThreadAwaiter(mainThreadQueue);
+}
+
+
+/// \brief A DeferredMethod that calls a coroutine listener method.
+///
+/// The coroutine's result completes the call's DeferredResult. Exceptions
+/// thrown by the coroutine reject the call.
+template <class ListenerClass>
+class CoroutineMethod_: public DeferredMethod
+{
+public:
+    /// \brief A typedef for the listener method signature.
+    typedef Task<ofJson> (ListenerClass::*ListenerMethod)(const ofJson& params);
+
+    /// \brief A typedef for the listener method signature with arguments.
+    typedef Task<ofJson> (ListenerClass::*ArgsListenerMethod)(MethodArgs& args);
+
+    CoroutineMethod_(const std::string& name,
+                     const ofJson& description,
+                     ListenerClass* listener,
+                     ListenerMethod listenerMethod,
+                     int priority):
+        DeferredMethod(name, description),
+        _listenerMethod([listener, listenerMethod](MethodArgs& args) {
+            return (listener->*listenerMethod)(args.params);
+        })
+    {
+        event.add(this, &CoroutineMethod_::onCall, priority);
+    }
+
+    CoroutineMethod_(const std::string& name,
+                     const ofJson& description,
+                     ListenerClass* listener,
+                     ArgsListenerMethod listenerMethod,
+                     int priority):
+        DeferredMethod(name, description),
+        _listenerMethod([listener, listenerMethod](MethodArgs& args) {
+            return (listener->*listenerMethod)(args);
+        })
+    {
+        event.add(this, &CoroutineMethod_::onCall, priority);
+    }
+
+    void onCall(DeferredMethodArgs& args)
+    {
+        // The coroutine may outlive the server event, so its arguments refer
+        // to DetachedServerEvent::sharedArgs() instead.
+        MethodArgs coroutineArgs(DetachedServerEvent::sharedArgs(), std::move(args.params));
+        coroutineArgs.cancellationToken = args.cancellationToken;
+        coroutineArgs.deadline = args.deadline;
+        coroutineArgs.connection = args.connection;
+        coroutineArgs.connectionId = args.connectionId;
+
+        run(_listenerMethod, std::move(coroutineArgs), args.deferredResult);
+    }
+
+private:
+    /// \brief Run the listener method to completion.
+    ///
+    /// The arguments are moved into the coroutine frame so that they stay
+    /// valid for the lifetime of the listener's coroutine.
+    static Detail::DetachedTask run(std::function<Task<ofJson>(MethodArgs&)> listenerMethod,
+                                    MethodArgs args,
+                                    DeferredResult deferredResult)
+    {
+        Error error;
+
+        try
+        {
+            ofJson result = co_await listenerMethod(args);
+            deferredResult.resolve(result);
+            co_return;
+        }
+        catch (const JSONRPCException& exc)
+        {
+            error = Error(exc.code(), exc.message(), nullptr);
+        }
+        catch (const Poco::Exception& exc)
+        {
+            error = Error(Errors::RPC_ERROR_INTERNAL_ERROR, exc.displayText(), nullptr);
+        }
+        catch (const std::exception& exc)
+        {
+            error = Error(Errors::RPC_ERROR_INTERNAL_ERROR, exc.what(), nullptr);
+        }
+        catch (...)
+        {
+            error = Error(Errors::RPC_ERROR_INTERNAL_ERROR, "Unknown Exception", nullptr);
+        }
+
+        deferredResult.reject(error);
+    }
+
+    /// \brief Calls the listener method.
+    std::function<Task<ofJson>(MethodArgs&)> _listenerMethod;
+
+};
+
+
+namespace Detail {
+
+
+template <typename T>
+inline Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+
+} // namespace Detail
+
+
+} } // namespace ofx::JSONRPC
+
+
+#endif // OFX_JSONRPC_HAS_COROUTINES
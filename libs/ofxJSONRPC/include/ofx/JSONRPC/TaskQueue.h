@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "ofx/JSONRPC/ThreadPool.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A queue of tasks that are executed on a shared ThreadPool.
+///
+/// A TaskQueue limits how many of its tasks run on the pool at once. With a
+/// concurrency of one, tasks are executed one at a time in the order they
+/// were submitted, even though they may run on different worker threads.
+///
+/// Each worker runs a single task before yielding the pool to other queues,
+/// so a queue with many pending tasks cannot starve the others.
+class TaskQueue
+{
+public:
+    /// \brief A typedef for a task.
+    typedef ThreadPool::Task Task;
+
+    /// \brief Create a TaskQueue.
+    /// \param threadPool The ThreadPool that executes the tasks. It must
+    ///        outlive the TaskQueue.
+    /// \param maxConcurrency The maximum number of tasks that may run at
+    ///        once. If zero, the number of tasks is not limited.
+    TaskQueue(ThreadPool& threadPool, std::size_t maxConcurrency = 1);
+
+    /// \brief Destroy the TaskQueue.
+    ///
+    /// The queue is closed before it is destroyed.
+    virtual ~TaskQueue();
+
+    /// \brief Submit a task.
+    /// \param task The task to execute. The task must not throw.
+    /// \returns false if the queue is closed and the task was discarded.
+    bool submit(Task task);
+
+    /// \brief Close the queue.
+    ///
+    /// Tasks that have not yet started are discarded and no new tasks are
+    /// accepted. This function returns after all running tasks have
+    /// completed, so it must not be called from one of the queue's tasks.
+    void close();
+
+    /// \returns true iff the queue is closed.
+    bool isClosed() const;
+
+    /// \returns the number of tasks waiting to run.
+    std::size_t numQueuedTasks() const;
+
+    /// \returns the number of tasks that are running or scheduled to run.
+    std::size_t numActiveTasks() const;
+
+private:
+    /// \brief Run the next task and reschedule if more are waiting.
+    void _runNext();
+
+    /// \brief The pool that executes the tasks.
+    ThreadPool& _threadPool;
+
+    /// \brief The maximum number of concurrent tasks, or zero for no limit.
+    std::size_t _maxConcurrency = 1;
+
+    /// \brief The number of workers scheduled to run tasks from this queue.
+    std::size_t _numActiveTasks = 0;
+
+    /// \brief The tasks waiting to run.
+    std::deque<Task> _tasks;
+
+    /// \brief True once the queue is closed.
+    bool _isClosed = false;
+
+    /// \brief The mutex protecting the queue.
+    mutable std::mutex _mutex;
+
+    /// \brief Signals close() when a running task completes.
+    std::condition_variable _condition;
+
+};
+
+
+} } // namespace ofx::JSONRPC
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#pragma once
+
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+/// \brief A fixed size pool of worker threads.
+///
+/// Tasks are executed in the order they are submitted by the first
+/// available worker thread.
+class ThreadPool
+{
+public:
+    /// \brief A typedef for a task.
+    typedef std::function<void()> Task;
+
+    /// \brief Create a ThreadPool.
+    /// \param numThreads The number of worker threads. If zero, the number
+    ///        of hardware threads will be used.
+    ThreadPool(std::size_t numThreads = 0);
+
+    /// \brief Destroy the ThreadPool.
+    ///
+    /// All tasks that have already been submitted will be executed before
+    /// the worker threads are joined.
+    virtual ~ThreadPool();
+
+    /// \brief Submit a task for execution on a worker thread.
+    /// \param task The task to execute. The task must not throw.
+    void submit(Task task);
+
+    /// \brief Call a function once for each index in [0, count).
+    ///
+    /// The calling thread participates in the work and this function returns
+    /// when all calls have completed. Because the calling thread will execute
+    /// any calls that have not been claimed by a worker, it is safe to call
+    /// this function from a task running on the same pool.
+    ///
+    /// \param count The number of calls to make.
+    /// \param function The function to call with each index. The function
+    ///        must not throw.
+    void parallelFor(std::size_t count,
+                     const std::function<void(std::size_t)>& function);
+
+    /// \returns the number of worker threads.
+    std::size_t size() const;
+
+    /// \returns the number of tasks waiting for a worker thread.
+    std::size_t numQueuedTasks() const;
+
+private:
+    /// \brief The worker thread loop.
+    void _run();
+
+    /// \brief The worker threads.
+    std::vector<std::thread> _threads;
+
+    /// \brief The tasks waiting for a worker thread.
+    std::deque<Task> _tasks;
+
+    /// \brief True until the pool is being destroyed.
+    bool _isRunning = true;
+
+    /// \brief The mutex protecting the task queue.
+    mutable std::mutex _mutex;
+
+    /// \brief Signals the worker threads when tasks are available.
+    std::condition_variable _condition;
+
+};
+
+
+} } // namespace ofx::JSONRPC
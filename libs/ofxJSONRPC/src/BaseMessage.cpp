@@ -25,6 +25,14 @@ BaseMessage::BaseMessage(HTTP::ServerEventArgs& evt,
 }
 
 
+BaseMessage::BaseMessage(HTTP::ServerEventArgs& evt,
+                         ofJson&& id):
+    HTTP::ServerEventArgs(evt),
+    _id(std::move(id))
+{
+}
+
+
 BaseMessage::~BaseMessage()
 {
 }
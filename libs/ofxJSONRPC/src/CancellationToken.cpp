@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/CancellationToken.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+CancellationToken::CancellationToken()
+{
+}
+
+
+CancellationToken CancellationToken::create()
+{
+    CancellationToken token;
+    token._state = std::make_shared<State>();
+    token._state->isCancelled = false;
+    return token;
+}
+
+
+CancellationToken::~CancellationToken()
+{
+}
+
+
+bool CancellationToken::cancel(const Error& error) const
+{
+    if (!_state)
+    {
+        return false;
+    }
+
+    std::vector<Callback> callbacks;
+
+    {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+
+        if (_state->isCancelled)
+        {
+            return false;
+        }
+
+        _state->error = error;
+        _state->isCancelled = true;
+
+        callbacks.swap(_state->callbacks);
+    }
+
+    for (const auto& callback: callbacks)
+    {
+        callback();
+    }
+
+    return true;
+}
+
+
+bool CancellationToken::isCancelled() const
+{
+    return _state && _state->isCancelled;
+}
+
+
+void CancellationToken::throwIfCancelled() const
+{
+    if (isCancelled())
+    {
+        Error cancellationError = error();
+        throw JSONRPCException(cancellationError.message(), cancellationError.code());
+    }
+}
+
+
+Error CancellationToken::error() const
+{
+    if (!_state)
+    {
+        return Error();
+    }
+
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    return _state->error;
+}
+
+
+void CancellationToken::onCancel(Callback callback) const
+{
+    if (!_state)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+
+        if (!_state->isCancelled)
+        {
+            _state->callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+
+    callback();
+}
+
+
+void CancellationToken::setDeadline(Clock::time_point deadline)
+{
+    if (!_state)
+    {
+        *this = create();
+    }
+
+    _state->deadline = deadline;
+}
+
+
+CancellationToken::Clock::time_point CancellationToken::deadline() const
+{
+    return _state ? _state->deadline : Clock::time_point::max();
+}
+
+
+bool CancellationToken::hasDeadline() const
+{
+    return deadline() != Clock::time_point::max();
+}
+
+
+bool CancellationToken::operator == (const CancellationToken& other) const
+{
+    return _state == other._state;
+}
+
+
+bool CancellationToken::operator != (const CancellationToken& other) const
+{
+    return _state != other._state;
+}
+
+
+} } // namespace ofx::JSONRPC
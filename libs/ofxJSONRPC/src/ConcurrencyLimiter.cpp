@@ -0,0 +1,266 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/ConcurrencyLimiter.h"
+#include <deque>
+#include <vector>
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+namespace {
+
+
+/// \brief The calls waiting to be started on this thread, if a call is
+///        being started.
+thread_local std::deque<std::function<void()>>* pendingStarts = nullptr;
+
+
+} // namespace
+
+
+ConcurrencyLimiter::Permit::Permit(std::shared_ptr<ConcurrencyLimiter> limiter):
+    _limiter(limiter),
+    _isReleased(false)
+{
+}
+
+
+ConcurrencyLimiter::Permit::~Permit()
+{
+    release();
+}
+
+
+void ConcurrencyLimiter::Permit::release()
+{
+    if (!_isReleased.exchange(true))
+    {
+        _limiter->_release();
+    }
+}
+
+
+ConcurrencyLimiter::ConcurrencyLimiter(const ConcurrencyPolicy& policy,
+                                       std::shared_ptr<Scheduler> scheduler,
+                                       Executor executor,
+                                       Executor timeoutExecutor):
+    _policy(policy),
+    _scheduler(scheduler),
+    _executor(executor),
+    _timeoutExecutor(timeoutExecutor)
+{
+}
+
+
+ConcurrencyLimiter::~ConcurrencyLimiter()
+{
+}
+
+
+void ConcurrencyLimiter::submit(Task task, RejectHandler rejectHandler)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_stats.numActiveCalls < _policy.maxConcurrency)
+    {
+        ++_stats.numActiveCalls;
+        ++_stats.numAdmitted;
+        lock.unlock();
+        task(std::make_shared<Permit>(shared_from_this()));
+        return;
+    }
+
+    if (_queuedCalls.size() >= _policy.maxQueuedCalls)
+    {
+        ++_stats.numRejected;
+        lock.unlock();
+        rejectHandler("Too many calls are in progress.");
+        return;
+    }
+
+    uint64_t callId = _nextCallId++;
+
+    QueuedCall& queuedCall = _queuedCalls[callId];
+    queuedCall.task = task;
+    queuedCall.rejectHandler = rejectHandler;
+
+    if (_policy.queueTimeout.count() > 0)
+    {
+        std::weak_ptr<ConcurrencyLimiter> limiter = shared_from_this();
+
+        queuedCall.timeoutId = _scheduler->schedule(_policy.queueTimeout, [limiter, callId]() {
+            std::shared_ptr<ConcurrencyLimiter> sharedLimiter = limiter.lock();
+
+            if (sharedLimiter)
+            {
+                sharedLimiter->_timeout(callId);
+            }
+        });
+    }
+
+    _stats.numQueuedCalls = _queuedCalls.size();
+}
+
+
+ConcurrencyLimiter::Stats ConcurrencyLimiter::stats() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+
+ConcurrencyPolicy ConcurrencyLimiter::policy() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _policy;
+}
+
+
+void ConcurrencyLimiter::setPolicy(const ConcurrencyPolicy& policy)
+{
+    std::vector<Task> tasks;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _policy = policy;
+
+        while (!_queuedCalls.empty() && _stats.numActiveCalls < _policy.maxConcurrency)
+        {
+            ++_stats.numActiveCalls;
+            tasks.push_back(_admitQueuedCall());
+        }
+    }
+
+    for (auto& task: tasks)
+    {
+        _start(task);
+    }
+}
+
+
+void ConcurrencyLimiter::_release()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // A lowered limit takes effect as calls in progress complete.
+    if (_queuedCalls.empty() || _stats.numActiveCalls > _policy.maxConcurrency)
+    {
+        --_stats.numActiveCalls;
+        return;
+    }
+
+    // The slot passes directly to the oldest queued call.
+    Task task = _admitQueuedCall();
+
+    lock.unlock();
+    _start(task);
+}
+
+
+ConcurrencyLimiter::Task ConcurrencyLimiter::_admitQueuedCall()
+{
+    auto iter = _queuedCalls.begin();
+    QueuedCall queuedCall = std::move(iter->second);
+    _queuedCalls.erase(iter);
+
+    ++_stats.numAdmitted;
+    _stats.numQueuedCalls = _queuedCalls.size();
+
+    if (queuedCall.timeoutId != 0)
+    {
+        _scheduler->cancel(queuedCall.timeoutId);
+    }
+
+    return queuedCall.task;
+}
+
+
+void ConcurrencyLimiter::_timeout(uint64_t callId)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto iter = _queuedCalls.find(callId);
+
+    // The call may have been admitted just before its timeout.
+    if (iter == _queuedCalls.end())
+    {
+        return;
+    }
+
+    RejectHandler rejectHandler = std::move(iter->second.rejectHandler);
+    _queuedCalls.erase(iter);
+
+    ++_stats.numTimedOut;
+    _stats.numQueuedCalls = _queuedCalls.size();
+
+    lock.unlock();
+
+    // Rejecting a call sends its response and may start the next call, so
+    // it is kept off the timer thread when possible.
+    if (_timeoutExecutor)
+    {
+        _timeoutExecutor([rejectHandler]() {
+            rejectHandler("Timed out waiting for other calls to complete.");
+        });
+        return;
+    }
+
+    rejectHandler("Timed out waiting for other calls to complete.");
+}
+
+
+void ConcurrencyLimiter::_start(Task task)
+{
+    std::shared_ptr<ConcurrencyLimiter> limiter = shared_from_this();
+
+    std::function<void()> start = [limiter, task]() {
+        task(std::make_shared<Permit>(limiter));
+    };
+
+    if (_executor)
+    {
+        _executor(start);
+        return;
+    }
+
+    if (pendingStarts)
+    {
+        pendingStarts->push_back(start);
+        return;
+    }
+
+    std::deque<std::function<void()>> starts;
+
+    struct Scope
+    {
+        Scope(std::deque<std::function<void()>>* starts)
+        {
+            pendingStarts = starts;
+        }
+
+        ~Scope()
+        {
+            pendingStarts = nullptr;
+        }
+    } scope(&starts);
+
+    start();
+
+    while (!starts.empty())
+    {
+        std::function<void()> next = std::move(starts.front());
+        starts.pop_front();
+        next();
+    }
+}
+
+
+} } // namespace ofx::JSONRPC
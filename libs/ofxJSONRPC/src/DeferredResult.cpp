@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/DeferredResult.h"
+#include "ofx/JSONRPC/DetachedServerEvent.h"
+#include "ofLog.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+DeferredResult::DeferredResult(const Request& request,
+                               ResponseHandler responseHandler,
+                               const CancellationToken& cancellationToken,
+                               FinishHandler finishHandler):
+    _state(std::make_shared<State>(request, responseHandler, cancellationToken, finishHandler))
+{
+    // The token must not keep the call alive, or an abandoned call would
+    // never be rejected. Cancelling only answers the call, it is finished
+    // when the method completes or abandons it.
+    std::weak_ptr<State> weakState = _state;
+
+    cancellationToken.onCancel([weakState]() {
+        std::shared_ptr<State> state = weakState.lock();
+
+        if (!state)
+        {
+            return;
+        }
+
+        if (!state->responseHandler)
+        {
+            state->complete();
+        }
+        else if (!state->isCompleted)
+        {
+            Response response(DetachedServerEvent::sharedArgs(), state->id, state->cancellationToken.error());
+            state->complete(response);
+        }
+    });
+}
+
+
+DeferredResult::~DeferredResult()
+{
+}
+
+
+bool DeferredResult::resolve(const ofJson& result) const
+{
+    bool completed = false;
+
+    if (!_state->responseHandler)
+    {
+        completed = _state->complete();
+    }
+    else
+    {
+        Response response(DetachedServerEvent::sharedArgs(), _state->id, result);
+        completed = _state->complete(response);
+    }
+
+    _state->finish();
+    return completed;
+}
+
+
+bool DeferredResult::resolveSerialized(Response::SerializedResult serializedResult) const
+{
+    bool completed = false;
+
+    if (!_state->responseHandler)
+    {
+        completed = _state->complete();
+    }
+    else
+    {
+        Response response = Response::fromSerialized(DetachedServerEvent::sharedArgs(), _state->id, serializedResult);
+        completed = _state->complete(response);
+    }
+
+    _state->finish();
+    return completed;
+}
+
+
+bool DeferredResult::reject(const Error& error) const
+{
+    bool completed = false;
+
+    if (!_state->responseHandler)
+    {
+        completed = _state->complete();
+    }
+    else
+    {
+        Response response(DetachedServerEvent::sharedArgs(), _state->id, error);
+        completed = _state->complete(response);
+    }
+
+    _state->finish();
+    return completed;
+}
+
+
+bool DeferredResult::isCompleted() const
+{
+    return _state->isCompleted;
+}
+
+
+const CancellationToken& DeferredResult::cancellationToken() const
+{
+    return _state->cancellationToken;
+}
+
+
+DeferredResult::State::State(const Request& request,
+                             ResponseHandler responseHandler,
+                             const CancellationToken& cancellationToken,
+                             FinishHandler finishHandler):
+    id(request.id()),
+    responseHandler(responseHandler),
+    cancellationToken(cancellationToken),
+    finishHandler(finishHandler),
+    isCompleted(false),
+    isFinished(false)
+{
+}
+
+
+DeferredResult::State::~State()
+{
+    if (!isCompleted && responseHandler)
+    {
+        Response response(DetachedServerEvent::sharedArgs(),
+                          id,
+                          Error(Errors::RPC_ERROR_INTERNAL_ERROR,
+                                "The method did not complete the call.",
+                                nullptr));
+        complete(response);
+    }
+
+    finish();
+}
+
+
+bool DeferredResult::State::complete(Response& response)
+{
+    if (isCompleted.exchange(true))
+    {
+        return false;
+    }
+
+    try
+    {
+        if (responseHandler)
+        {
+            responseHandler(response);
+        }
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogError("DeferredResult::complete") << "Response handler failed: " << exc.what();
+    }
+    catch (...)
+    {
+        ofLogError("DeferredResult::complete") << "Response handler failed: Unknown Exception";
+    }
+
+    return true;
+}
+
+
+bool DeferredResult::State::complete()
+{
+    return !isCompleted.exchange(true);
+}
+
+
+void DeferredResult::State::finish()
+{
+    if (isFinished.exchange(true) || !finishHandler)
+    {
+        return;
+    }
+
+    try
+    {
+        finishHandler();
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogError("DeferredResult::finish") << "Finish handler failed: " << exc.what();
+    }
+    catch (...)
+    {
+        ofLogError("DeferredResult::finish") << "Finish handler failed: Unknown Exception";
+    }
+}
+
+
+} } // namespace ofx::JSONRPC
@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/DetachedServerEvent.h"
+#include <sstream>
+#include "Poco/NullStream.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/SocketAddress.h"
+#include "ofxHTTP.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+namespace {
+
+
+/// \brief A server response that is not connected to a client.
+class DetachedServerResponse: public Poco::Net::HTTPServerResponse
+{
+public:
+    void sendContinue() override
+    {
+    }
+
+    std::ostream& send() override
+    {
+        _sent = true;
+        return _stream;
+    }
+
+    void sendFile(const std::string&, const std::string&) override
+    {
+        _sent = true;
+    }
+
+    void sendBuffer(const void*, std::size_t) override
+    {
+        _sent = true;
+    }
+
+    void redirect(const std::string&, HTTPStatus) override
+    {
+        _sent = true;
+    }
+
+    void requireAuthentication(const std::string&) override
+    {
+        _sent = true;
+    }
+
+    bool sent() const override
+    {
+        return _sent;
+    }
+
+private:
+    /// \brief The stream that discards the response body.
+    Poco::NullOutputStream _stream;
+
+    /// \brief True if the response was sent.
+    bool _sent = false;
+
+};
+
+
+/// \brief A server request that is not connected to a client.
+class DetachedServerRequest: public Poco::Net::HTTPServerRequest
+{
+public:
+    /// \brief Create a DetachedServerRequest.
+    /// \param response The response to the request.
+    DetachedServerRequest(Poco::Net::HTTPServerResponse& response):
+        _response(response),
+        _serverParams(new Poco::Net::HTTPServerParams())
+    {
+    }
+
+    std::istream& stream() override
+    {
+        return _stream;
+    }
+
+    const Poco::Net::SocketAddress& clientAddress() const override
+    {
+        return _clientAddress;
+    }
+
+    const Poco::Net::SocketAddress& serverAddress() const override
+    {
+        return _serverAddress;
+    }
+
+    const Poco::Net::HTTPServerParams& serverParams() const override
+    {
+        return *_serverParams;
+    }
+
+    Poco::Net::HTTPServerResponse& response() const override
+    {
+        return _response;
+    }
+
+    bool secure() const override
+    {
+        return false;
+    }
+
+private:
+    /// \brief The response to the request.
+    Poco::Net::HTTPServerResponse& _response;
+
+    /// \brief The empty request body.
+    std::istringstream _stream;
+
+    /// \brief The unspecified client address.
+    Poco::Net::SocketAddress _clientAddress;
+
+    /// \brief The unspecified server address.
+    Poco::Net::SocketAddress _serverAddress;
+
+    /// \brief The default server parameters.
+    Poco::Net::HTTPServerParams::Ptr _serverParams;
+
+};
+
+
+} // namespace
+
+
+DetachedServerEvent::DetachedServerEvent():
+    _response(new DetachedServerResponse()),
+    _request(new DetachedServerRequest(*_response)),
+    _session(new HTTP::SimpleSession()),
+    _args(new HTTP::ServerEventArgs(*_request, *_response, *_session))
+{
+}
+
+
+DetachedServerEvent::~DetachedServerEvent()
+{
+}
+
+
+HTTP::ServerEventArgs& DetachedServerEvent::args()
+{
+    return *_args;
+}
+
+
+HTTP::ServerEventArgs& DetachedServerEvent::sharedArgs()
+{
+    static DetachedServerEvent event;
+    return event.args();
+}
+
+
+} } // namespace ofx::JSONRPC
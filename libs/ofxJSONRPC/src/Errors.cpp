@@ -19,6 +19,9 @@ const int Errors::RPC_ERROR_METHOD_NOT_FOUND    = -32601;
 const int Errors::RPC_ERROR_INVALID_PARAMETERS  = -32602;
 const int Errors::RPC_ERROR_INTERNAL_ERROR      = -32603;
 const int Errors::RPC_ERROR_PARSE               = -32700;
+const int Errors::RPC_ERROR_SERVER_BUSY         = -32000;
+const int Errors::RPC_ERROR_DEADLINE_EXCEEDED   = -32001;
+const int Errors::RPC_ERROR_REQUEST_CANCELLED   = -32800;
 
 
 std::string Errors::getErrorMessage(int code)
@@ -37,6 +40,12 @@ std::string Errors::getErrorMessage(int code)
             return "RPC_ERROR_INTERNAL_ERROR";
         case Errors::RPC_ERROR_PARSE:
             return "RPC_ERROR_PARSE";
+        case Errors::RPC_ERROR_SERVER_BUSY:
+            return "RPC_ERROR_SERVER_BUSY";
+        case Errors::RPC_ERROR_DEADLINE_EXCEEDED:
+            return "RPC_ERROR_DEADLINE_EXCEEDED";
+        case Errors::RPC_ERROR_REQUEST_CANCELLED:
+            return "RPC_ERROR_REQUEST_CANCELLED";
         default:
         {
             if (code >= -32099 && code <= -32000)
@@ -77,5 +86,17 @@ POCO_IMPLEMENT_EXCEPTION(ParseException,
                          JSONRPCException,
                          "RPC_ERROR_PARSE")
 
+POCO_IMPLEMENT_EXCEPTION(ServerBusyException,
+                         JSONRPCException,
+                         "RPC_ERROR_SERVER_BUSY")
+
+POCO_IMPLEMENT_EXCEPTION(DeadlineExceededException,
+                         JSONRPCException,
+                         "RPC_ERROR_DEADLINE_EXCEEDED")
+
+POCO_IMPLEMENT_EXCEPTION(RequestCancelledException,
+                         JSONRPCException,
+                         "RPC_ERROR_REQUEST_CANCELLED")
+
 
 } } // namespace ofx::JSONRPC
@@ -6,12 +6,62 @@
 
 
 #include "ofx/JSONRPC/JSONRPCUtils.h"
+#include "Poco/StringTokenizer.h"
 
 
 namespace ofx {
 namespace JSONRPC {
 
 
+namespace {
+
+
+/// \brief Determine whether a single subprotocol has the coalesce suffix.
+/// \param subprotocol The subprotocol.
+/// \returns true iff the subprotocol ends with the suffix.
+bool hasCoalesceSuffix(const std::string& subprotocol)
+{
+    const std::string& suffix = JSONRPCUtils::COALESCE_SUBPROTOCOL_SUFFIX;
+
+    return subprotocol.size() > suffix.size() &&
+           subprotocol.compare(subprotocol.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+
+} // namespace
+
+
+const std::string JSONRPCUtils::JSON_SUBPROTOCOL = "jsonrpc";
+const std::string JSONRPCUtils::CBOR_SUBPROTOCOL = "jsonrpc-cbor";
+const std::string JSONRPCUtils::MESSAGE_PACK_SUBPROTOCOL = "jsonrpc-msgpack";
+const std::string JSONRPCUtils::COALESCE_SUBPROTOCOL_SUFFIX = "+coalesce";
+
+
+JSONRPCUtils::StringStreamBuffer::StringStreamBuffer(std::string& buffer):
+    _buffer(buffer)
+{
+}
+
+
+JSONRPCUtils::StringStreamBuffer::int_type JSONRPCUtils::StringStreamBuffer::overflow(int_type c)
+{
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        _buffer.push_back(traits_type::to_char_type(c));
+    }
+
+    return traits_type::not_eof(c);
+}
+
+
+std::streamsize JSONRPCUtils::StringStreamBuffer::xsputn(const char* s,
+                                                        std::streamsize n)
+{
+    _buffer.append(s, static_cast<std::size_t>(n));
+    return n;
+}
+
+
 std::string JSONRPCUtils::toString(const ofJson& json, bool styled)
 {
     std::string raw;
@@ -29,6 +79,196 @@ std::string JSONRPCUtils::toString(const ofJson& json, bool styled)
 }
 
 
+ofJson JSONRPCUtils::parse(const ofBuffer& buffer)
+{
+    const char* data = buffer.getData();
+    return ofJson::parse(data, data + buffer.size());
+}
+
+
+ofJson JSONRPCUtils::parse(const ofBuffer& buffer, Encoding encoding)
+{
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(buffer.getData());
+
+#if defined(NLOHMANN_JSON_VERSION_MAJOR) && NLOHMANN_JSON_VERSION_MAJOR >= 3
+    switch (encoding)
+    {
+        case Encoding::CBOR:
+            return ofJson::from_cbor(data, data + buffer.size());
+        case Encoding::MESSAGE_PACK:
+            return ofJson::from_msgpack(data, data + buffer.size());
+        case Encoding::JSON:
+            break;
+    }
+#else
+    // Older versions can only decode binary data from a vector.
+    switch (encoding)
+    {
+        case Encoding::CBOR:
+            return ofJson::from_cbor(std::vector<std::uint8_t>(data, data + buffer.size()));
+        case Encoding::MESSAGE_PACK:
+            return ofJson::from_msgpack(std::vector<std::uint8_t>(data, data + buffer.size()));
+        case Encoding::JSON:
+            break;
+    }
+#endif
+
+    return parse(buffer);
+}
+
+
+void JSONRPCUtils::write(const ofJson& json,
+                         Encoding encoding,
+                         std::string& buffer)
+{
+#if defined(NLOHMANN_JSON_VERSION_MAJOR) && NLOHMANN_JSON_VERSION_MAJOR >= 3
+    switch (encoding)
+    {
+        case Encoding::CBOR:
+            ofJson::to_cbor(json, buffer);
+            return;
+        case Encoding::MESSAGE_PACK:
+            ofJson::to_msgpack(json, buffer);
+            return;
+        case Encoding::JSON:
+            break;
+    }
+#else
+    // Older versions can only encode binary data to a vector.
+    std::vector<std::uint8_t> bytes;
+
+    switch (encoding)
+    {
+        case Encoding::CBOR:
+            bytes = ofJson::to_cbor(json);
+            buffer.append(bytes.begin(), bytes.end());
+            return;
+        case Encoding::MESSAGE_PACK:
+            bytes = ofJson::to_msgpack(json);
+            buffer.append(bytes.begin(), bytes.end());
+            return;
+        case Encoding::JSON:
+            break;
+    }
+#endif
+
+    StringStreamBuffer streamBuffer(buffer);
+    std::ostream stream(&streamBuffer);
+    stream << json;
+}
+
+
+void JSONRPCUtils::writeArrayHeader(std::size_t size,
+                                    Encoding encoding,
+                                    std::string& buffer)
+{
+    // Both encodings use a short form for small arrays and big-endian sizes
+    // otherwise.
+    int sizeBytes = 0;
+
+    if (encoding == Encoding::CBOR)
+    {
+        if (size < 24)
+        {
+            buffer.push_back(static_cast<char>(0x80 | size));
+        }
+        else if (size <= 0xFF)
+        {
+            buffer.push_back(static_cast<char>(0x98));
+            sizeBytes = 1;
+        }
+        else if (size <= 0xFFFF)
+        {
+            buffer.push_back(static_cast<char>(0x99));
+            sizeBytes = 2;
+        }
+        else
+        {
+            buffer.push_back(static_cast<char>(0x9A));
+            sizeBytes = 4;
+        }
+    }
+    else if (encoding == Encoding::MESSAGE_PACK)
+    {
+        if (size < 16)
+        {
+            buffer.push_back(static_cast<char>(0x90 | size));
+        }
+        else if (size <= 0xFFFF)
+        {
+            buffer.push_back(static_cast<char>(0xDC));
+            sizeBytes = 2;
+        }
+        else
+        {
+            buffer.push_back(static_cast<char>(0xDD));
+            sizeBytes = 4;
+        }
+    }
+
+    for (int i = sizeBytes - 1; i >= 0; --i)
+    {
+        buffer.push_back(static_cast<char>((size >> (i * 8)) & 0xFF));
+    }
+}
+
+
+std::string JSONRPCUtils::selectSubprotocol(const std::string& subprotocols)
+{
+    Poco::StringTokenizer tokenizer(subprotocols,
+                                    ",",
+                                    Poco::StringTokenizer::TOK_TRIM |
+                                    Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+
+    for (const auto& subprotocol: tokenizer)
+    {
+        std::string base = subprotocol;
+
+        if (hasCoalesceSuffix(subprotocol))
+        {
+            base.resize(base.size() - COALESCE_SUBPROTOCOL_SUFFIX.size());
+        }
+
+        if (base == JSON_SUBPROTOCOL ||
+            base == CBOR_SUBPROTOCOL ||
+            base == MESSAGE_PACK_SUBPROTOCOL)
+        {
+            return subprotocol;
+        }
+    }
+
+    return "";
+}
+
+
+Encoding JSONRPCUtils::encodingForSubprotocols(const std::string& subprotocols)
+{
+    std::string subprotocol = selectSubprotocol(subprotocols);
+
+    if (hasCoalesceSuffix(subprotocol))
+    {
+        subprotocol.resize(subprotocol.size() - COALESCE_SUBPROTOCOL_SUFFIX.size());
+    }
+
+    if (subprotocol == CBOR_SUBPROTOCOL)
+    {
+        return Encoding::CBOR;
+    }
+    else if (subprotocol == MESSAGE_PACK_SUBPROTOCOL)
+    {
+        return Encoding::MESSAGE_PACK;
+    }
+
+    return Encoding::JSON;
+}
+
+
+bool JSONRPCUtils::isCoalescingSubprotocol(const std::string& subprotocols)
+{
+    return hasCoalesceSuffix(selectSubprotocol(subprotocols));
+}
+
+
 bool JSONRPCUtils::hasKey(const ofJson& json, const std::string& key)
 {
     return json.find(key) != json.end();
@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/LatencyHistogram.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+const std::size_t LatencyHistogram::NUM_EXACT_VALUES;
+const std::size_t LatencyHistogram::NUM_SUB_BUCKETS;
+const std::size_t LatencyHistogram::NUM_OCTAVES;
+const std::size_t LatencyHistogram::NUM_BUCKETS;
+
+
+double LatencyHistogram::Snapshot::mean() const
+{
+    return count > 0 ? double(sum) / double(count) : 0;
+}
+
+
+uint64_t LatencyHistogram::Snapshot::percentile(double percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+
+    // The rank of the value at the percentile, starting at 1.
+    uint64_t rank = std::max(uint64_t(1), uint64_t(percentile / 100.0 * double(count) + 0.5));
+
+    uint64_t total = 0;
+
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+        total += counts[i];
+
+        if (total >= rank)
+        {
+            return std::max(min, std::min(max, bucketUpperBound(i)));
+        }
+    }
+
+    return max;
+}
+
+
+ofJson LatencyHistogram::Snapshot::toJSON(const Snapshot& snapshot)
+{
+    ofJson json;
+    json["count"] = snapshot.count;
+    json["min"] = snapshot.min;
+    json["max"] = snapshot.max;
+    json["mean"] = snapshot.mean();
+    json["p50"] = snapshot.percentile(50);
+    json["p90"] = snapshot.percentile(90);
+    json["p99"] = snapshot.percentile(99);
+    json["p999"] = snapshot.percentile(99.9);
+    return json;
+}
+
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+
+void LatencyHistogram::record(uint64_t value)
+{
+    _counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t currentMin = _min.load(std::memory_order_relaxed);
+
+    while (value < currentMin && !_min.compare_exchange_weak(currentMin, value, std::memory_order_relaxed))
+    {
+    }
+
+    uint64_t currentMax = _max.load(std::memory_order_relaxed);
+
+    while (value > currentMax && !_max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.counts.resize(NUM_BUCKETS);
+
+    for (std::size_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        snapshot.counts[i] = _counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+
+    // The count is the sum of the bucket counts so that percentiles are
+    // consistent with it.
+    if (snapshot.count > 0)
+    {
+        snapshot.min = _min.load(std::memory_order_relaxed);
+        snapshot.max = _max.load(std::memory_order_relaxed);
+        snapshot.sum = _sum.load(std::memory_order_relaxed);
+
+        // A value being recorded may be counted before it updates the
+        // minimum.
+        snapshot.min = std::min(snapshot.min, snapshot.max);
+    }
+
+    return snapshot;
+}
+
+
+void LatencyHistogram::reset()
+{
+    for (auto& count: _counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    _min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+}
+
+
+std::size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < NUM_EXACT_VALUES)
+    {
+        return std::size_t(value);
+    }
+
+    // The index of the most significant bit, at least 5.
+    std::size_t msb = 0;
+
+    for (std::size_t shift = 32; shift > 0; shift /= 2)
+    {
+        if (value >> (msb + shift))
+        {
+            msb += shift;
+        }
+    }
+
+    std::size_t octave = msb - 5;
+
+    if (octave >= NUM_OCTAVES)
+    {
+        return NUM_BUCKETS - 1;
+    }
+
+    // The four bits below the most significant bit select the sub-bucket.
+    std::size_t subBucket = std::size_t(value >> (msb - 4)) & (NUM_SUB_BUCKETS - 1);
+
+    return NUM_EXACT_VALUES + octave * NUM_SUB_BUCKETS + subBucket;
+}
+
+
+uint64_t LatencyHistogram::bucketUpperBound(std::size_t index)
+{
+    if (index < NUM_EXACT_VALUES)
+    {
+        return index;
+    }
+
+    std::size_t octave = (index - NUM_EXACT_VALUES) / NUM_SUB_BUCKETS;
+    std::size_t subBucket = (index - NUM_EXACT_VALUES) % NUM_SUB_BUCKETS;
+
+    uint64_t lowerBound = uint64_t(NUM_SUB_BUCKETS + subBucket) << (octave + 1);
+
+    return lowerBound + (uint64_t(1) << (octave + 1)) - 1;
+}
+
+
+} } // namespace ofx::JSONRPC
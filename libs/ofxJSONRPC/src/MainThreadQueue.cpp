@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/MainThreadQueue.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+MainThreadQueue::MainThreadQueue():
+    _head(nullptr),
+    _isStarted(false)
+{
+}
+
+
+MainThreadQueue::~MainThreadQueue()
+{
+    if (_isStarted)
+    {
+        ofRemoveListener(ofEvents().update, this, &MainThreadQueue::onUpdate);
+    }
+
+    clear();
+}
+
+
+void MainThreadQueue::start()
+{
+    std::call_once(_startFlag, [this]() {
+        ofAddListener(ofEvents().update, this, &MainThreadQueue::onUpdate);
+        _isStarted = true;
+    });
+}
+
+
+void MainThreadQueue::submit(Task task)
+{
+    Node* node = new Node();
+    node->task = std::move(task);
+    node->next = _head.load(std::memory_order_relaxed);
+
+    while (!_head.compare_exchange_weak(node->next,
+                                        node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+    {
+    }
+}
+
+
+std::size_t MainThreadQueue::drain()
+{
+    std::size_t count = 0;
+
+    Node* node = _takeAll();
+
+    while (node != nullptr)
+    {
+        node->task();
+        Node* next = node->next;
+        delete node;
+        node = next;
+        ++count;
+    }
+
+    return count;
+}
+
+
+void MainThreadQueue::clear()
+{
+    Node* node = _takeAll();
+
+    while (node != nullptr)
+    {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+
+void MainThreadQueue::onUpdate(ofEventArgs&)
+{
+    drain();
+}
+
+
+MainThreadQueue::Node* MainThreadQueue::_takeAll()
+{
+    Node* node = _head.exchange(nullptr, std::memory_order_acquire);
+
+    // Reverse the list to restore submission order.
+    Node* first = nullptr;
+
+    while (node != nullptr)
+    {
+        Node* next = node->next;
+        node->next = first;
+        first = node;
+        node = next;
+    }
+
+    return first;
+}
+
+
+} } // namespace ofx::JSONRPC
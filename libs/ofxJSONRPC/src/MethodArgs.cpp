@@ -17,7 +17,25 @@ MethodArgs::MethodArgs(HTTP::ServerEventArgs& evt,
     HTTP::ServerEventArgs(evt),
     params(params),
     result(nullptr),
-    error(Error())
+    serializedResult(nullptr),
+    error(Error()),
+    deadline(CancellationToken::Clock::time_point::max()),
+    connection(nullptr),
+    connectionId(0)
+{
+}
+
+
+MethodArgs::MethodArgs(HTTP::ServerEventArgs& evt,
+                       ofJson&& params):
+    HTTP::ServerEventArgs(evt),
+    params(std::move(params)),
+    result(nullptr),
+    serializedResult(nullptr),
+    error(Error()),
+    deadline(CancellationToken::Clock::time_point::max()),
+    connection(nullptr),
+    connectionId(0)
 {
 }
 
@@ -42,4 +60,27 @@ std::string MethodArgs::toString(bool styled) const
 }
 
 
+DeferredMethodArgs::DeferredMethodArgs(HTTP::ServerEventArgs& evt,
+                                       const ofJson& params,
+                                       const DeferredResult& deferredResult):
+    MethodArgs(evt, params),
+    deferredResult(deferredResult)
+{
+}
+
+
+DeferredMethodArgs::DeferredMethodArgs(HTTP::ServerEventArgs& evt,
+                                       ofJson&& params,
+                                       const DeferredResult& deferredResult):
+    MethodArgs(evt, std::move(params)),
+    deferredResult(deferredResult)
+{
+}
+
+
+DeferredMethodArgs::~DeferredMethodArgs()
+{
+}
+
+
 } } // namespace ofx::JSONRPC
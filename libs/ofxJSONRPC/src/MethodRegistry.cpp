@@ -6,13 +6,34 @@
 
 
 #include "ofx/JSONRPC/MethodRegistry.h"
+#include <future>
+#include "ofx/JSONRPC/DetachedServerEvent.h"
+#include "ofThread.h"
 
 
 namespace ofx {
 namespace JSONRPC {
 
 
-MethodRegistry::MethodRegistry()
+const ofJson& MethodRegistry::MethodEntry::description() const
+{
+    switch (type)
+    {
+        case Type::NO_ARG_METHOD:
+            return noArgMethod->description();
+        case Type::DEFERRED_METHOD:
+            return deferredMethod->description();
+        case Type::METHOD:
+        default:
+            return method->description();
+    }
+}
+
+
+MethodRegistry::MethodRegistry():
+    _scheduler(std::make_shared<Scheduler>()),
+    _isStatsEnabled(false),
+    _methodTable(std::make_shared<MethodTable>())
 {
 }
 
@@ -26,155 +47,799 @@ void MethodRegistry::unregisterMethod(const std::string& method)
 {
     std::unique_lock<std::mutex> lock(_mutex);
 
-    MethodMapIter methodIter = _methodMap.find(method);
+    SharedMethodTablePtr currentTable = methodTable();
 
-    if (methodIter != _methodMap.end())
+    if (currentTable->find(method) == currentTable->end())
     {
-        _methodMap.erase(methodIter);
         return;
     }
 
-    NoArgMethodMapIter noArgMethodIter = _noArgMethodMap.find(method);
-    
-    if (noArgMethodIter != _noArgMethodMap.end())
+    std::shared_ptr<MethodTable> table = std::make_shared<MethodTable>(*currentTable);
+    table->erase(method);
+    std::atomic_store(&_methodTable, SharedMethodTablePtr(table));
+}
+
+
+Response MethodRegistry::processCall(const void* pSender, Request& request)
+{
+    std::promise<Response> promise;
+    std::future<Response> future = promise.get_future();
+
+    processCall(pSender, request, [&promise](Response& response) {
+        promise.set_value(response);
+    });
+
+    // Deferred methods may complete on another thread.
+    return future.get();
+}
+
+
+void MethodRegistry::processCall(const void* pSender,
+                                 Request& request,
+                                 ResponseHandler responseHandler,
+                                 const CancellationToken& cancellationToken)
+{
+    // The table is immutable, so the lookup needs no lock. The table keeps
+    // the method alive even if it is unregistered while the call is in
+    // progress.
+    SharedMethodTablePtr table = methodTable();
+
+    MethodTable::const_iterator entryIter = table->find(request.method());
+
+    if (entryIter == table->end())
     {
-        _noArgMethodMap.erase(noArgMethodIter);
+        DeferredResult(request, responseHandler).reject(Error(Errors::RPC_ERROR_METHOD_NOT_FOUND,
+                                                              Request::toJSON(request)));
         return;
     }
+
+    const MethodEntry& entry = entryIter->second;
+
+    MethodStats::SharedCallTimerPtr callTimer = nullptr;
+
+    if (entry.stats && responseHandler)
+    {
+        // Calls answered from the cache are counted too.
+        callTimer = std::make_shared<MethodStats::CallTimer>(entry.stats, request.receivedTime());
+
+        ResponseHandler callHandler = responseHandler;
+
+        responseHandler = [callTimer, callHandler](Response& response) {
+            callTimer->respond(response);
+            callHandler(response);
+        };
+    }
+
+    if (entry.cache && responseHandler)
+    {
+        std::string key = ResultCache::key(request.parameters());
+
+        ResultCache::SerializedResult serializedResult = entry.cache->get(key);
+
+        if (serializedResult)
+        {
+            // Answer from the cache without invoking the method.
+            Response response = Response::fromSerialized(request, request.id(), serializedResult);
+            responseHandler(response);
+
+            if (callTimer)
+            {
+                callTimer->complete();
+            }
+
+            return;
+        }
+
+        // Cache successful results as they complete.
+        std::shared_ptr<ResultCache> cache = entry.cache;
+
+        responseHandler = [cache, key, responseHandler](Response& response) {
+            if (response.serializedResult())
+            {
+                cache->put(key, response.serializedResult());
+            }
+            else if (!response.isErrorResponse())
+            {
+                cache->put(key, response.result());
+            }
+
+            responseHandler(response);
+        };
+    }
+
+    admitMethod(pSender, entry, request, responseHandler, cancellationToken, callTimer);
 }
 
 
-Response MethodRegistry::processCall(const void* pSender, Request& request)
+void MethodRegistry::processNotification(const void* pSender, Request& request)
 {
     try
     {
-        std::unique_lock<std::mutex> lock(_mutex);
+        SharedMethodTablePtr table = methodTable();
+
+        MethodTable::const_iterator entryIter = table->find(request.method());
 
-        const std::string& method = request.method();
+        if (entryIter == table->end())
+        {
+            ofLogVerbose("MethodRegistry::processNotification") << "Method not found: " << request.method();
+            return;
+        }
 
-        NoArgMethodMapIter noArgMethodIter = _noArgMethodMap.find(method);
+        const MethodEntry& entry = entryIter->second;
 
-        MethodMapIter methodIter = _methodMap.find(method);
+        if (entry.stats)
+        {
+            entry.stats->recordNotification();
+        }
 
-        if (methodIter != _methodMap.end())
+        if (entry.limiter || std::atomic_load(&_concurrencyLimiter))
         {
-            MethodArgs args(request, request.parameters());
+            admitMethod(pSender, entry, request, nullptr, CancellationToken(), nullptr);
+            return;
+        }
 
-            // Argument result is filled in the event notification callback.
-            ofNotifyEvent((*methodIter).second->event, args, pSender);
+        if (entry.dispatch == MethodDispatch::MAIN_THREAD && !ofThread::isMainThread())
+        {
+            // Without a response handler, completing the result does not
+            // create a Response.
+            queueMethod(pSender, entry, request, DeferredResult(request, nullptr), nullptr);
+            return;
+        }
 
-            // If an error is present, then ignore any args.results
-            // and return the error response.
-            if (Errors::RPC_ERROR_NONE == args.error.code())
+        switch (entry.type)
+        {
+            case MethodEntry::Type::METHOD:
+            {
+                // The parameters are moved to avoid copying large payloads.
+                MethodArgs args(request, std::move(request.parameters()));
+                args.connection = request.connection();
+                args.connectionId = request.connectionId();
+                ofNotifyEvent(entry.method->event, args, pSender);
+                break;
+            }
+            case MethodEntry::Type::NO_ARG_METHOD:
             {
-                return Response(request,
-                                request.id(),
-                                args.result);
+                if (request.parameters().is_null())
+                {
+                    ofNotifyEvent(entry.noArgMethod->event, pSender);
+                }
+                else
+                {
+                    ofLogVerbose("MethodRegistry::processNotification") << "Method does not support parameters: " << request.method();
+                }
+                break;
             }
-            else
+            case MethodEntry::Type::DEFERRED_METHOD:
             {
-                // Return the error.
-                return Response(request,
-                                request.id(),
-                                args.error);
+                // Without a response handler, completing the result does
+                // not create a Response.
+                DeferredMethodArgs args(request,
+                                        std::move(request.parameters()),
+                                        DeferredResult(request, nullptr));
+                args.connection = request.connection();
+                args.connectionId = request.connectionId();
+                ofNotifyEvent(entry.deferredMethod->event, args, pSender);
+                break;
             }
         }
-        else if (noArgMethodIter != _noArgMethodMap.end())
+    }
+    catch (const std::exception& exc)
+    {
+        ofLogVerbose("MethodRegistry::processNotification") << request.method() << ": " << exc.what();
+    }
+    catch ( ... )
+    {
+        ofLogVerbose("MethodRegistry::processNotification") << request.method() << ": Unknown Exception";
+    }
+}
+
+
+void MethodRegistry::processNotification(const void* pSender,
+                                         const Request& request,
+                                         ThreadPool& threadPool)
+{
+    Request copy(request);
+    std::shared_ptr<Request> queuedRequest = detachRequest(copy);
+
+    threadPool.submit([this, pSender, queuedRequest]() {
+        processNotification(pSender, *queuedRequest);
+    });
+}
+
+
+ResultCache::Stats MethodRegistry::cacheStats(const std::string& method) const
+{
+    SharedMethodTablePtr table = methodTable();
+
+    MethodTable::const_iterator entryIter = table->find(method);
+
+    if (entryIter == table->end() || !entryIter->second.cache)
+    {
+        return ResultCache::Stats();
+    }
+
+    return entryIter->second.cache->stats();
+}
+
+
+void MethodRegistry::clearCache(const std::string& method)
+{
+    SharedMethodTablePtr table = methodTable();
+
+    MethodTable::const_iterator entryIter = table->find(method);
+
+    if (entryIter != table->end() && entryIter->second.cache)
+    {
+        entryIter->second.cache->clear();
+    }
+}
+
+
+void MethodRegistry::setConcurrencyPolicy(const std::string& method,
+                                          const ConcurrencyPolicy& policy)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    SharedMethodTablePtr currentTable = methodTable();
+
+    MethodTable::const_iterator entryIter = currentTable->find(method);
+
+    if (entryIter == currentTable->end())
+    {
+        return;
+    }
+
+    // An existing limiter keeps counting the calls in progress. Admitted
+    // calls may start on this thread, so the mutex is released.
+    if (policy.isEnabled() && entryIter->second.limiter)
+    {
+        std::shared_ptr<ConcurrencyLimiter> limiter = entryIter->second.limiter;
+        lock.unlock();
+        limiter->setPolicy(policy);
+        return;
+    }
+
+    // Calls in progress keep the previous limiter until they complete.
+    std::shared_ptr<MethodTable> table = std::make_shared<MethodTable>(*currentTable);
+    (*table)[method].limiter = policy.isEnabled() ? std::make_shared<ConcurrencyLimiter>(policy, _scheduler, _concurrencyExecutor, completionExecutor()) : nullptr;
+    std::atomic_store(&_methodTable, SharedMethodTablePtr(table));
+}
+
+
+void MethodRegistry::setConcurrencyPolicy(const ConcurrencyPolicy& policy)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    std::shared_ptr<ConcurrencyLimiter> limiter = std::atomic_load(&_concurrencyLimiter);
+
+    // An existing limiter keeps counting the calls in progress. Admitted
+    // calls may start on this thread, so the mutex is released.
+    if (policy.isEnabled() && limiter)
+    {
+        lock.unlock();
+        limiter->setPolicy(policy);
+        return;
+    }
+
+    limiter = policy.isEnabled() ? std::make_shared<ConcurrencyLimiter>(policy, _scheduler, _concurrencyExecutor, completionExecutor()) : nullptr;
+    std::atomic_store(&_concurrencyLimiter, limiter);
+}
+
+
+void MethodRegistry::setConcurrencyExecutor(ConcurrencyLimiter::Executor executor)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _concurrencyExecutor = executor;
+}
+
+
+Scheduler& MethodRegistry::scheduler()
+{
+    return *_scheduler;
+}
+
+
+MainThreadQueue& MethodRegistry::mainThreadQueue()
+{
+    return _mainThreadQueue;
+}
+
+
+ConcurrencyLimiter::Stats MethodRegistry::concurrencyStats(const std::string& method) const
+{
+    SharedMethodTablePtr table = methodTable();
+
+    MethodTable::const_iterator entryIter = table->find(method);
+
+    if (entryIter == table->end() || !entryIter->second.limiter)
+    {
+        return ConcurrencyLimiter::Stats();
+    }
+
+    return entryIter->second.limiter->stats();
+}
+
+
+ConcurrencyLimiter::Stats MethodRegistry::concurrencyStats() const
+{
+    std::shared_ptr<ConcurrencyLimiter> limiter = std::atomic_load(&_concurrencyLimiter);
+    return limiter ? limiter->stats() : ConcurrencyLimiter::Stats();
+}
+
+
+void MethodRegistry::setStatsEnabled(bool enabled)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_isStatsEnabled == enabled)
+    {
+        return;
+    }
+
+    _isStatsEnabled = enabled;
+
+    std::shared_ptr<MethodTable> table = std::make_shared<MethodTable>(*methodTable());
+
+    for (auto& entry: *table)
+    {
+        entry.second.stats = enabled ? std::make_shared<MethodStats>() : nullptr;
+    }
+
+    std::atomic_store(&_methodTable, SharedMethodTablePtr(table));
+}
+
+
+bool MethodRegistry::isStatsEnabled() const
+{
+    return _isStatsEnabled;
+}
+
+
+MethodStats::Snapshot MethodRegistry::methodStats(const std::string& method) const
+{
+    std::shared_ptr<MethodStats> stats = sharedMethodStats(method);
+    return stats ? stats->snapshot() : MethodStats::Snapshot();
+}
+
+
+std::map<std::string, MethodStats::Snapshot> MethodRegistry::methodStats() const
+{
+    SharedMethodTablePtr table = methodTable();
+
+    std::map<std::string, MethodStats::Snapshot> stats;
+
+    for (const auto& entry: *table)
+    {
+        if (entry.second.stats)
+        {
+            stats[entry.first] = entry.second.stats->snapshot();
+        }
+    }
+
+    return stats;
+}
+
+
+void MethodRegistry::resetMethodStats()
+{
+    SharedMethodTablePtr table = methodTable();
+
+    for (const auto& entry: *table)
+    {
+        if (entry.second.stats)
         {
-            if (request.parameters().is_null())
+            entry.second.stats->reset();
+        }
+    }
+}
+
+
+bool MethodRegistry::hasMethod(const std::string& method) const
+{
+    SharedMethodTablePtr table = methodTable();
+    return table->find(method) != table->end();
+}
+
+
+MethodRegistry::MethodDescriptionMap MethodRegistry::methods() const
+{
+    SharedMethodTablePtr table = methodTable();
+    MethodRegistry::MethodDescriptionMap methods;
+    
+    for (const auto& entry: *table)
+    {
+        methods[entry.first] = entry.second.description();
+    }
+
+    return methods;
+}
+
+
+MethodRegistry::MethodDescriptionMap MethodRegistry::getMethods() const
+{
+    return methods();
+}
+
+
+void MethodRegistry::admitMethod(const void* pSender,
+                                 const MethodEntry& entry,
+                                 Request& request,
+                                 ResponseHandler responseHandler,
+                                 const CancellationToken& cancellationToken,
+                                 MethodStats::SharedCallTimerPtr callTimer)
+{
+    if (responseHandler && cancellationToken.hasDeadline())
+    {
+        // The deadline includes any time spent waiting for a free slot.
+        CancellationToken::Clock::duration delay = cancellationToken.deadline() - CancellationToken::Clock::now();
+
+        std::shared_ptr<Scheduler> scheduler = _scheduler;
+        ConcurrencyLimiter::Executor executor = completionExecutor();
+
+        // Cancelling answers the call, which is kept off the timer thread.
+        Scheduler::TaskId timerId = scheduler->schedule(std::chrono::duration_cast<std::chrono::microseconds>(delay), [executor, cancellationToken]() {
+            executor([cancellationToken]() {
+                cancellationToken.cancel(Error(Errors::RPC_ERROR_DEADLINE_EXCEEDED));
+            });
+        });
+
+        ResponseHandler callHandler = responseHandler;
+
+        responseHandler = [scheduler, timerId, callHandler](Response& response) {
+            scheduler->cancel(timerId);
+            callHandler(response);
+        };
+    }
+
+    std::shared_ptr<ConcurrencyLimiter> methodLimiter = entry.limiter;
+    std::shared_ptr<ConcurrencyLimiter> globalLimiter = std::atomic_load(&_concurrencyLimiter);
+
+    // A cancelled call is answered early, but it is only finished once its
+    // method has returned or abandoned it.
+    DeferredResult::FinishHandler finishTimer = nullptr;
+
+    if (callTimer)
+    {
+        finishTimer = [callTimer]() {
+            callTimer->complete();
+        };
+    }
+
+    if (!methodLimiter && !globalLimiter)
+    {
+        // Every call is completed exactly once through the DeferredResult.
+        DeferredResult deferredResult(request, responseHandler, cancellationToken, finishTimer);
+        dispatchMethod(pSender, entry, request, deferredResult, callTimer);
+        return;
+    }
+
+    // The call may wait in a queue, so it needs its own copy of the Request.
+    std::shared_ptr<Request> queuedRequest = detachRequest(request);
+
+    typedef ConcurrencyLimiter::SharedPermitPtr SharedPermitPtr;
+
+    // The permits are released once the call finishes, not when a cancelled
+    // call is answered, so a limit is never exceeded by abandoned methods.
+    auto start = [this, pSender, entry, queuedRequest, responseHandler, cancellationToken, callTimer](SharedPermitPtr methodPermit,
+                                                                                                      SharedPermitPtr globalPermit) {
+        DeferredResult deferredResult(*queuedRequest, responseHandler, cancellationToken, [callTimer, methodPermit, globalPermit]() {
+            if (callTimer)
             {
-                ofNotifyEvent((*noArgMethodIter).second->event, pSender);
+                callTimer->complete();
+            }
 
-                return Response(request, request.id(), nullptr);
+            if (globalPermit)
+            {
+                globalPermit->release();
             }
-            else
+
+            if (methodPermit)
             {
-                return Response(request,
-                                request.id(),
-                                Error(Errors::RPC_ERROR_INVALID_REQUEST,
-                                      "This method does not support parameters.",
-                                      Request::toJSON(request)));
+                methodPermit->release();
             }
+        });
+
+        dispatchMethod(pSender, entry, *queuedRequest, deferredResult, callTimer);
+    };
+
+    auto reject = [queuedRequest, responseHandler, cancellationToken, finishTimer](const std::string& reason) {
+        ofLogVerbose("MethodRegistry::admitMethod") << queuedRequest->method() << ": " << reason;
+        DeferredResult(*queuedRequest, responseHandler, cancellationToken, finishTimer).reject(Error(Errors::RPC_ERROR_SERVER_BUSY,
+                                                                                    reason,
+                                                                                    nullptr));
+    };
+
+    auto admitGlobal = [start, reject, globalLimiter](SharedPermitPtr methodPermit) {
+        if (!globalLimiter)
+        {
+            start(methodPermit, nullptr);
+            return;
         }
-        else
+
+        globalLimiter->submit([start, methodPermit](SharedPermitPtr globalPermit) {
+            start(methodPermit, globalPermit);
+        },
+        [reject, methodPermit](const std::string& reason) {
+            if (methodPermit)
+            {
+                methodPermit->release();
+            }
+
+            reject(reason);
+        });
+    };
+
+    if (methodLimiter)
+    {
+        methodLimiter->submit(admitGlobal, reject);
+    }
+    else
+    {
+        admitGlobal(nullptr);
+    }
+}
+
+
+void MethodRegistry::dispatchMethod(const void* pSender,
+                                    const MethodEntry& entry,
+                                    Request& request,
+                                    const DeferredResult& deferredResult,
+                                    MethodStats::SharedCallTimerPtr callTimer)
+{
+    if (deferredResult.cancellationToken().isCancelled())
+    {
+        deferredResult.reject(deferredResult.cancellationToken().error());
+        return;
+    }
+
+    if (entry.dispatch == MethodDispatch::MAIN_THREAD && !ofThread::isMainThread())
+    {
+        queueMethod(pSender, entry, request, deferredResult, callTimer);
+    }
+    else
+    {
+        invokeMethod(pSender, entry, request, deferredResult, callTimer);
+    }
+}
+
+
+void MethodRegistry::invokeMethod(const void* pSender,
+                                  const MethodEntry& entry,
+                                  Request& request,
+                                  const DeferredResult& deferredResult,
+                                  MethodStats::SharedCallTimerPtr callTimer)
+{
+    if (callTimer)
+    {
+        callTimer->start();
+    }
+
+    try
+    {
+        switch (entry.type)
         {
-            return Response(request,
-                            request.id(),
-                            Error(Errors::RPC_ERROR_METHOD_NOT_FOUND,
-                                  Request::toJSON(request)));
+            case MethodEntry::Type::METHOD:
+            {
+                // The parameters are moved to avoid copying large payloads.
+                MethodArgs args(request, std::move(request.parameters()));
+                args.cancellationToken = deferredResult.cancellationToken();
+                args.deadline = args.cancellationToken.deadline();
+                args.connection = request.connection();
+                args.connectionId = request.connectionId();
+
+                // Argument result is filled in the event notification callback.
+                ofNotifyEvent(entry.method->event, args, pSender);
+
+                // If an error is present, then ignore any args.results
+                // and return the error response.
+                if (Errors::RPC_ERROR_NONE != args.error.code())
+                {
+                    // Return the error.
+                    deferredResult.reject(args.error);
+                }
+                else if (args.serializedResult)
+                {
+                    deferredResult.resolveSerialized(args.serializedResult);
+                }
+                else
+                {
+                    deferredResult.resolve(args.result);
+                }
+                break;
+            }
+            case MethodEntry::Type::NO_ARG_METHOD:
+            {
+                if (request.parameters().is_null())
+                {
+                    ofNotifyEvent(entry.noArgMethod->event, pSender);
+                    deferredResult.resolve(nullptr);
+                }
+                else
+                {
+                    deferredResult.reject(Error(Errors::RPC_ERROR_INVALID_REQUEST,
+                                                "This method does not support parameters.",
+                                                Request::toJSON(request)));
+                }
+                break;
+            }
+            case MethodEntry::Type::DEFERRED_METHOD:
+            {
+                DeferredMethodArgs args(request,
+                                        std::move(request.parameters()),
+                                        deferredResult);
+                args.cancellationToken = deferredResult.cancellationToken();
+                args.deadline = args.cancellationToken.deadline();
+                args.connection = request.connection();
+                args.connectionId = request.connectionId();
+
+                // The result is completed by the callback, possibly later.
+                ofNotifyEvent(entry.deferredMethod->event, args, pSender);
+
+                if (Errors::RPC_ERROR_NONE != args.error.code())
+                {
+                    deferredResult.reject(args.error);
+                }
+                break;
+            }
         }
     }
     catch (const JSONRPCException& exc)
     {
-        return Response(request,
-                        request.id(),
-                        Error(exc.code(),
-                              exc.message()));
+        deferredResult.reject(Error(exc.code(),
+                                    exc.message()));
     }
     catch (const Poco::InvalidArgumentException& exc)
     {
-        return Response(request,
-                        request.id(),
-                        Error(Errors::RPC_ERROR_INVALID_PARAMETERS,
-                              Request::toJSON(request)));
+        deferredResult.reject(Error(Errors::RPC_ERROR_INVALID_PARAMETERS,
+                                    Request::toJSON(request)));
     }
     catch (const Poco::Exception& exc)
     {
-        return Response(request,
-                        request.id(),
-                        Error(Errors::RPC_ERROR_INTERNAL_ERROR,
-                              exc.displayText(),
-                              Request::toJSON(request)));
+        deferredResult.reject(Error(Errors::RPC_ERROR_INTERNAL_ERROR,
+                                    exc.displayText(),
+                                    Request::toJSON(request)));
     }
     catch (const std::exception& exc)
     {
-        return Response(request,
-                        request.id(),
-                        Error(Errors::RPC_ERROR_INTERNAL_ERROR,
-                              exc.what(),
-                              Request::toJSON(request)));
+        deferredResult.reject(Error(Errors::RPC_ERROR_INTERNAL_ERROR,
+                                    exc.what(),
+                                    Request::toJSON(request)));
     }
     catch ( ... )
     {
-        return Response(request,
-                        request.id(),
-                        Error(Errors::RPC_ERROR_INTERNAL_ERROR,
-                              "Unknown Exception",
-                              Request::toJSON(request)));
+        deferredResult.reject(Error(Errors::RPC_ERROR_INTERNAL_ERROR,
+                                    "Unknown Exception",
+                                    Request::toJSON(request)));
     }
 }
 
 
-void MethodRegistry::processNotification(const void* pSender, Request& request)
+void MethodRegistry::queueMethod(const void* pSender,
+                                 const MethodEntry& entry,
+                                 Request& request,
+                                 const DeferredResult& deferredResult,
+                                 MethodStats::SharedCallTimerPtr callTimer)
 {
-    processCall(pSender, request); // return nothing
+    // The entry keeps the method alive until the queued call is invoked.
+    std::shared_ptr<Request> queuedRequest = detachRequest(request);
+
+    _mainThreadQueue.submit([this, pSender, entry, queuedRequest, deferredResult, callTimer]() {
+        // The call may have been cancelled while it was queued.
+        dispatchMethod(pSender, entry, *queuedRequest, deferredResult, callTimer);
+    });
 }
 
 
-bool MethodRegistry::hasMethod(const std::string& method) const
+std::shared_ptr<Request> MethodRegistry::detachRequest(Request& request)
 {
-    std::unique_lock<std::mutex> lock(_mutex);
-    return _methodMap.find(method) != _methodMap.end();
+    std::shared_ptr<Request> queuedRequest = std::make_shared<Request>(DetachedServerEvent::sharedArgs(),
+                                                                       ofJson(request.id()),
+                                                                       request.method(),
+                                                                       std::move(request.parameters()));
+    queuedRequest->setConnection(request.connection(), request.connectionId());
+    queuedRequest->setReceivedTime(request.receivedTime());
+    return queuedRequest;
 }
 
 
-MethodRegistry::MethodDescriptionMap MethodRegistry::methods() const
+ConcurrencyLimiter::Executor MethodRegistry::completionExecutor()
 {
-    std::unique_lock<std::mutex> lock(_mutex);
-    MethodRegistry::MethodDescriptionMap methods;
-    
-    for (const auto& method: _methodMap)
-    {
-        methods[method.first] = method.second->description();
-    }
+    std::call_once(_completionThreadFlag, [this]() {
+        _completionThread = std::make_shared<ThreadPool>(1);
+    });
 
-    return methods;
+    // Timers may outlive the registry, so they must not keep its thread.
+    std::weak_ptr<ThreadPool> weakThread = _completionThread;
+
+    return [weakThread](std::function<void()> function) {
+        std::shared_ptr<ThreadPool> completionThread = weakThread.lock();
+
+        if (completionThread)
+        {
+            completionThread->submit(function);
+        }
+        else
+        {
+            // The registry has been destroyed.
+            function();
+        }
+    };
 }
 
 
-MethodRegistry::MethodDescriptionMap MethodRegistry::getMethods() const
+MethodRegistry::SharedMethodTablePtr MethodRegistry::methodTable() const
 {
-    return methods();
+    return std::atomic_load(&_methodTable);
+}
+
+
+std::shared_ptr<MethodStats> MethodRegistry::sharedMethodStats(const std::string& method) const
+{
+    SharedMethodTablePtr table = methodTable();
+
+    MethodTable::const_iterator entryIter = table->find(method);
+
+    return entryIter != table->end() ? entryIter->second.stats : nullptr;
+}
+
+
+void MethodRegistry::addMethod(SharedMethodPtr method,
+                               MethodDispatch dispatch,
+                               const CachePolicy& cachePolicy)
+{
+    MethodEntry entry;
+    entry.type = MethodEntry::Type::METHOD;
+    entry.method = method;
+    entry.dispatch = dispatch;
+    entry.cache = cachePolicy.isEnabled() ? std::make_shared<ResultCache>(cachePolicy) : nullptr;
+    addMethodEntry(method->name(), entry);
+}
+
+
+void MethodRegistry::addMethod(SharedNoArgMethodPtr method,
+                               MethodDispatch dispatch,
+                               const CachePolicy& cachePolicy)
+{
+    MethodEntry entry;
+    entry.type = MethodEntry::Type::NO_ARG_METHOD;
+    entry.noArgMethod = method;
+    entry.dispatch = dispatch;
+    entry.cache = cachePolicy.isEnabled() ? std::make_shared<ResultCache>(cachePolicy) : nullptr;
+    addMethodEntry(method->name(), entry);
+}
+
+
+void MethodRegistry::addMethod(SharedDeferredMethodPtr method,
+                               MethodDispatch dispatch,
+                               const CachePolicy& cachePolicy)
+{
+    MethodEntry entry;
+    entry.type = MethodEntry::Type::DEFERRED_METHOD;
+    entry.deferredMethod = method;
+    entry.dispatch = dispatch;
+    entry.cache = cachePolicy.isEnabled() ? std::make_shared<ResultCache>(cachePolicy) : nullptr;
+    addMethodEntry(method->name(), entry);
+}
+
+
+void MethodRegistry::addMethodEntry(const std::string& name,
+                                    const MethodEntry& entry)
+{
+    if (entry.dispatch == MethodDispatch::MAIN_THREAD)
+    {
+        _mainThreadQueue.start();
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::shared_ptr<MethodTable> table = std::make_shared<MethodTable>(*methodTable());
+    (*table)[name] = entry;
+
+    if (_isStatsEnabled)
+    {
+        (*table)[name].stats = std::make_shared<MethodStats>();
+    }
+
+    std::atomic_store(&_methodTable, SharedMethodTablePtr(table));
 }
 
 
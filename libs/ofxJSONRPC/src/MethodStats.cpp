@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/MethodStats.h"
+#include <limits>
+#include "ofx/JSONRPC/Errors.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+const std::size_t MethodStats::NUM_PHASES;
+
+
+ofJson MethodStats::Snapshot::toJSON(const Snapshot& snapshot)
+{
+    ofJson json;
+    json["calls"] = snapshot.numCalls;
+    json["notifications"] = snapshot.numNotifications;
+    json["activeCalls"] = snapshot.numActiveCalls;
+    json["errors"] = snapshot.numErrors;
+
+    ofJson errorsByCode = ofJson::object();
+
+    for (const auto& entry: snapshot.numErrorsByCode)
+    {
+        errorsByCode[std::to_string(entry.first)] = entry.second;
+    }
+
+    json["errorsByCode"] = errorsByCode;
+
+    double elapsedSeconds = snapshot.elapsedTime.count() / 1000000.0;
+
+    json["elapsedTime"] = elapsedSeconds;
+    json["callsPerSecond"] = elapsedSeconds > 0 ? snapshot.numCalls / elapsedSeconds : 0;
+
+    ofJson phases = ofJson::object();
+
+    for (std::size_t i = 0; i < NUM_PHASES; ++i)
+    {
+        phases[toString(Phase(i))] = LatencyHistogram::Snapshot::toJSON(snapshot.phases[i]);
+    }
+
+    json["phases"] = phases;
+
+    return json;
+}
+
+
+MethodStats::CallTimer::CallTimer(std::shared_ptr<MethodStats> stats,
+                                  Clock::time_point receivedTime):
+    _stats(stats),
+    _receivedTime(receivedTime == Clock::time_point() ? Clock::now() : receivedTime),
+    _startTime(std::numeric_limits<Clock::rep>::min()),
+    _errorCode(Errors::RPC_ERROR_NONE)
+{
+    _stats->_numActiveCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void MethodStats::CallTimer::start()
+{
+    Clock::time_point startTime = Clock::now();
+    _startTime.store(startTime.time_since_epoch().count());
+    _stats->record(Phase::QUEUE, startTime - _receivedTime);
+}
+
+
+void MethodStats::CallTimer::respond(const Response& response)
+{
+    _errorCode = response.isErrorResponse() ? response.error().code() : Errors::RPC_ERROR_NONE;
+}
+
+
+void MethodStats::CallTimer::complete()
+{
+    Clock::rep startTime = _startTime.load();
+
+    // Calls answered without invoking the method, e.g. from a cache or
+    // because they were rejected, have no handler phase.
+    if (startTime != std::numeric_limits<Clock::rep>::min())
+    {
+        _stats->record(Phase::HANDLER, Clock::now() - Clock::time_point(Clock::duration(startTime)));
+    }
+
+    _stats->recordCall(_errorCode);
+    _stats->_numActiveCalls.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+MethodStats::MethodStats():
+    _numCalls(0),
+    _numNotifications(0),
+    _numActiveCalls(0),
+    _numErrors(0),
+    _startTime(Clock::now().time_since_epoch().count())
+{
+}
+
+
+MethodStats::~MethodStats()
+{
+}
+
+
+void MethodStats::record(Phase phase, Clock::duration duration)
+{
+    int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    _phases[std::size_t(phase)].record(microseconds > 0 ? uint64_t(microseconds) : 0);
+}
+
+
+void MethodStats::recordCall(int errorCode)
+{
+    _numCalls.fetch_add(1, std::memory_order_relaxed);
+
+    if (errorCode != Errors::RPC_ERROR_NONE)
+    {
+        _numErrors.fetch_add(1, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        ++_numErrorsByCode[errorCode];
+    }
+}
+
+
+void MethodStats::recordNotification()
+{
+    _numNotifications.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+MethodStats::Snapshot MethodStats::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.numCalls = _numCalls.load(std::memory_order_relaxed);
+    snapshot.numNotifications = _numNotifications.load(std::memory_order_relaxed);
+    snapshot.numActiveCalls = _numActiveCalls.load(std::memory_order_relaxed);
+    snapshot.numErrors = _numErrors.load(std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < NUM_PHASES; ++i)
+    {
+        snapshot.phases[i] = _phases[i].snapshot();
+    }
+
+    Clock::time_point startTime = Clock::time_point(Clock::duration(_startTime.load()));
+    snapshot.elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    snapshot.numErrorsByCode = _numErrorsByCode;
+    return snapshot;
+}
+
+
+void MethodStats::reset()
+{
+    for (auto& phase: _phases)
+    {
+        phase.reset();
+    }
+
+    _numCalls.store(0, std::memory_order_relaxed);
+    _numNotifications.store(0, std::memory_order_relaxed);
+    _numErrors.store(0, std::memory_order_relaxed);
+    _startTime.store(Clock::now().time_since_epoch().count());
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _numErrorsByCode.clear();
+}
+
+
+std::string MethodStats::toString(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::PARSE:
+            return "parse";
+        case Phase::QUEUE:
+            return "queue";
+        case Phase::HANDLER:
+            return "handler";
+        case Phase::SERIALIZE:
+            return "serialize";
+        case Phase::SEND:
+            return "send";
+    }
+
+    return "unknown";
+}
+
+
+} } // namespace ofx::JSONRPC
@@ -35,6 +35,16 @@ Request::Request(HTTP::ServerEventArgs& evt,
 }
 
 
+Request::Request(HTTP::ServerEventArgs& evt,
+                 const std::string& method,
+                 ofJson&& parameters):
+    BaseMessage(evt, nullptr),
+    _method(method),
+    _parameters(std::move(parameters))
+{
+}
+
+
 Request::Request(HTTP::ServerEventArgs& evt,
                  const ofJson& id,
                  const std::string& method):
@@ -57,6 +67,17 @@ Request::Request(HTTP::ServerEventArgs& evt,
 }
 
 
+Request::Request(HTTP::ServerEventArgs& evt,
+                 ofJson&& id,
+                 const std::string& method,
+                 ofJson&& parameters):
+    BaseMessage(evt, std::move(id)),
+    _method(method),
+    _parameters(std::move(parameters))
+{
+}
+
+
 Request::~Request()
 {
 }
@@ -80,6 +101,12 @@ const ofJson& Request::parameters() const
 }
 
 
+ofJson& Request::parameters()
+{
+    return _parameters;
+}
+
+
 const ofJson& Request::getParameters() const
 {
     return parameters();
@@ -92,6 +119,38 @@ bool Request::isNotification() const
 }
 
 
+void Request::setConnection(const HTTP::WebSocketConnection* connection,
+                            uint64_t connectionId)
+{
+    _connection = connection;
+    _connectionId = connectionId;
+}
+
+
+const HTTP::WebSocketConnection* Request::connection() const
+{
+    return _connection;
+}
+
+
+uint64_t Request::connectionId() const
+{
+    return _connectionId;
+}
+
+
+void Request::setReceivedTime(std::chrono::steady_clock::time_point receivedTime)
+{
+    _receivedTime = receivedTime;
+}
+
+
+std::chrono::steady_clock::time_point Request::receivedTime() const
+{
+    return _receivedTime;
+}
+
+
 std::string Request::toString(bool styled) const
 {
     return JSONRPCUtils::toString(toJSON(*this), styled);
@@ -116,6 +175,23 @@ ofJson Request::toJSON(const Request& request)
 }
 
 
+ofJson Request::notificationToJSON(const std::string& method,
+                                   const ofJson& params)
+{
+    ofJson result;
+
+    result[PROTOCOL_VERSION_TAG] = PROTOCOL_VERSION;
+    result[METHOD_TAG] = method;
+
+    if (!params.is_null())
+    {
+        result[PARAMS_TAG] = params;
+    }
+
+    return result;
+}
+
+
 Request Request::fromJSON(HTTP::ServerEventArgs& evt,
                           const ofJson& json)
 {
@@ -165,4 +241,41 @@ Request Request::fromJSON(HTTP::ServerEventArgs& evt,
 }
 
 
+Request Request::fromJSON(HTTP::ServerEventArgs& evt,
+                          ofJson&& json)
+{
+    if (JSONRPCUtils::hasStringKey(json, PROTOCOL_VERSION_TAG) &&
+        json[PROTOCOL_VERSION_TAG] == PROTOCOL_VERSION)
+    {
+        if (JSONRPCUtils::hasStringKey(json, METHOD_TAG))
+        {
+            const std::string& method = json[METHOD_TAG].get_ref<const std::string&>();
+
+            auto paramsIter = json.find(PARAMS_TAG);
+
+            ofJson params = (paramsIter != json.end()) ? std::move(*paramsIter) : ofJson(nullptr);
+
+            auto idIter = json.find(ID_TAG);
+
+            if (idIter != json.end())
+            {
+                return Request(evt, std::move(*idIter), method, std::move(params));
+            }
+            else
+            {
+                return Request(evt, method, std::move(params));
+            }
+        }
+        else
+        {
+            throw ParseException("No method.");
+        }
+    }
+    else
+    {
+        throw ParseException("No version string.");
+    }
+}
+
+
 } } // namespace ofx::JSONRPC
@@ -15,6 +15,8 @@ namespace JSONRPC {
 
 const std::string Response::ERROR_TAG = "error";
 const std::string Response::RESULT_TAG = "result";
+const std::string Response::RESULT_PREFIX = "{\"jsonrpc\":\"2.0\",\"result\":";
+const std::string Response::ID_PREFIX = ",\"id\":";
 
 
 Response::Response(HTTP::ServerEventArgs& evt):
@@ -52,6 +54,18 @@ Response::~Response()
 
 const ofJson& Response::result() const
 {
+    if (_parsedResult)
+    {
+        ParsedResult& parsedResult = *_parsedResult;
+        const std::string& serializedResult = *_serializedResult;
+
+        std::call_once(parsedResult.flag, [&parsedResult, &serializedResult]() {
+            parsedResult.result = ofJson::parse(serializedResult);
+        });
+
+        return parsedResult.result;
+    }
+
     return _result;
 }
 
@@ -61,6 +75,12 @@ const ofJson& Response::getResult() const
     return result();
 }
 
+Response::SerializedResult Response::serializedResult() const
+{
+    return _serializedResult;
+}
+
+
 const Error& Response::error() const
 {
     return _error;
@@ -81,7 +101,102 @@ bool Response::isErrorResponse() const
 
 std::string Response::toString(bool styled) const
 {
-    return JSONRPCUtils::toString(toJSON(*this), styled);
+    if (styled)
+    {
+        return JSONRPCUtils::toString(toJSON(*this), styled);
+    }
+
+    std::string buffer;
+    write(buffer);
+    return buffer;
+}
+
+
+void Response::write(std::ostream& stream) const
+{
+    stream << "{\"" << PROTOCOL_VERSION_TAG << "\":\"" << PROTOCOL_VERSION << "\",";
+
+    if (isErrorResponse())
+    {
+        stream << "\"" << ERROR_TAG << "\":" << Error::toJSON(error());
+    }
+    else
+    {
+        stream << "\"" << RESULT_TAG << "\":";
+
+        if (_serializedResult)
+        {
+            stream << *_serializedResult;
+        }
+        else
+        {
+            stream << result();
+        }
+    }
+
+    stream << ",\"" << ID_TAG << "\":" << id() << "}";
+}
+
+
+void Response::write(std::string& buffer) const
+{
+    if (_serializedResult && !isErrorResponse())
+    {
+        // The envelope is constant, so only the id needs to be serialized.
+        buffer.append(RESULT_PREFIX);
+        buffer.append(*_serializedResult);
+        buffer.append(ID_PREFIX);
+
+        if (id().is_number_unsigned())
+        {
+            buffer.append(std::to_string(id().get<uint64_t>()));
+        }
+        else if (id().is_number_integer())
+        {
+            buffer.append(std::to_string(id().get<int64_t>()));
+        }
+        else
+        {
+            buffer.append(id().dump());
+        }
+
+        buffer.push_back('}');
+        return;
+    }
+
+    JSONRPCUtils::StringStreamBuffer streamBuffer(buffer);
+    std::ostream stream(&streamBuffer);
+    write(stream);
+}
+
+
+void Response::write(std::string& buffer, Encoding encoding) const
+{
+    if (encoding == Encoding::JSON)
+    {
+        write(buffer);
+    }
+    else
+    {
+        JSONRPCUtils::write(toJSON(*this), encoding, buffer);
+    }
+}
+
+
+Response Response::fromSerialized(HTTP::ServerEventArgs& evt,
+                                  const ofJson& id,
+                                  SerializedResult serializedResult)
+{
+    Response response(evt, id, ofJson(nullptr));
+    response._serializedResult = serializedResult;
+    response._parsedResult = std::make_shared<ParsedResult>();
+    return response;
+}
+
+
+Response::SerializedResult Response::serializeResult(const ofJson& result)
+{
+    return std::make_shared<const std::string>(result.dump());
 }
 
 
@@ -91,15 +206,15 @@ ofJson Response::toJSON(const Response& response)
 
     result[PROTOCOL_VERSION_TAG] = PROTOCOL_VERSION;
 
-    result["id"] = response.id();
+    result[ID_TAG] = response.id();
 
     if (response.isErrorResponse())
     {
-        result["error"] = Error::toJSON(response.error());
+        result[ERROR_TAG] = Error::toJSON(response.error());
     }
     else
     {
-        result["result"] = response.result();
+        result[RESULT_TAG] = response.result();
     }
 
     return result;
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/ResultCache.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+ResultCache::ResultCache(const CachePolicy& policy):
+    _policy(policy),
+    _numHits(0),
+    _numMisses(0)
+{
+}
+
+
+ResultCache::~ResultCache()
+{
+}
+
+
+std::string ResultCache::key(const ofJson& params)
+{
+    return params.dump();
+}
+
+
+ResultCache::SerializedResult ResultCache::get(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto iter = _entries.find(key);
+
+    if (iter == _entries.end())
+    {
+        ++_numMisses;
+        return nullptr;
+    }
+
+    if (Clock::now() >= iter->second.expires)
+    {
+        _usage.erase(iter->second.usage);
+        _entries.erase(iter);
+        ++_numMisses;
+        return nullptr;
+    }
+
+    // Mark the entry as most recently used.
+    _usage.splice(_usage.begin(), _usage, iter->second.usage);
+
+    ++_numHits;
+    return iter->second.result;
+}
+
+
+ResultCache::SerializedResult ResultCache::put(const std::string& key,
+                                               const ofJson& result)
+{
+    // Serialize outside of the lock.
+    return put(key, std::make_shared<const std::string>(result.dump()));
+}
+
+
+ResultCache::SerializedResult ResultCache::put(const std::string& key,
+                                               SerializedResult serializedResult)
+{
+    Clock::time_point expires = Clock::now() + _policy.timeToLive;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto iter = _entries.find(key);
+
+    if (iter != _entries.end())
+    {
+        iter->second.result = serializedResult;
+        iter->second.expires = expires;
+        _usage.splice(_usage.begin(), _usage, iter->second.usage);
+        return serializedResult;
+    }
+
+    while (!_usage.empty() && _entries.size() >= _policy.maxEntries)
+    {
+        _entries.erase(_usage.back());
+        _usage.pop_back();
+    }
+
+    _usage.push_front(key);
+
+    Entry& entry = _entries[key];
+    entry.result = serializedResult;
+    entry.expires = expires;
+    entry.usage = _usage.begin();
+
+    return serializedResult;
+}
+
+
+void ResultCache::clear()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _entries.clear();
+    _usage.clear();
+}
+
+
+ResultCache::Stats ResultCache::stats() const
+{
+    Stats stats;
+    stats.numHits = _numHits;
+    stats.numMisses = _numMisses;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    stats.numEntries = _entries.size();
+    return stats;
+}
+
+
+const CachePolicy& ResultCache::policy() const
+{
+    return _policy;
+}
+
+
+} } // namespace ofx::JSONRPC
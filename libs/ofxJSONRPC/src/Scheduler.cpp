@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/Scheduler.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+Scheduler::Scheduler()
+{
+}
+
+
+Scheduler::~Scheduler()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _isRunning = false;
+    }
+
+    _condition.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+
+Scheduler::TaskId Scheduler::schedule(std::chrono::microseconds delay, Task task)
+{
+    Clock::time_point dueTime = Clock::now() + delay;
+
+    TaskId taskId = 0;
+    bool isEarliest = false;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (!_thread.joinable())
+        {
+            _thread = std::thread(&Scheduler::_run, this);
+        }
+
+        taskId = _nextTaskId++;
+
+        isEarliest = _dueTimes.empty() || dueTime < _dueTimes.begin()->first;
+
+        _dueTimes.insert(std::make_pair(dueTime, taskId));
+        _tasks[taskId] = std::make_pair(dueTime, std::move(task));
+    }
+
+    // The timer thread only needs to wake up if it is waiting for a later
+    // due time.
+    if (isEarliest)
+    {
+        _condition.notify_one();
+    }
+
+    return taskId;
+}
+
+
+bool Scheduler::cancel(TaskId taskId)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto iter = _tasks.find(taskId);
+
+    if (iter == _tasks.end())
+    {
+        return false;
+    }
+
+    _dueTimes.erase(std::make_pair(iter->second.first, taskId));
+    _tasks.erase(iter);
+    return true;
+}
+
+
+std::size_t Scheduler::numScheduledTasks() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+
+void Scheduler::_run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (_isRunning)
+    {
+        if (_dueTimes.empty())
+        {
+            _condition.wait(lock);
+            continue;
+        }
+
+        auto next = *_dueTimes.begin();
+
+        if (Clock::now() < next.first)
+        {
+            _condition.wait_until(lock, next.first);
+            continue;
+        }
+
+        _dueTimes.erase(_dueTimes.begin());
+
+        auto iter = _tasks.find(next.second);
+        Task task = std::move(iter->second.second);
+        _tasks.erase(iter);
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+
+} } // namespace ofx::JSONRPC
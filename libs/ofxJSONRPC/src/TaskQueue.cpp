@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/TaskQueue.h"
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+TaskQueue::TaskQueue(ThreadPool& threadPool, std::size_t maxConcurrency):
+    _threadPool(threadPool),
+    _maxConcurrency(maxConcurrency)
+{
+}
+
+
+TaskQueue::~TaskQueue()
+{
+    close();
+}
+
+
+bool TaskQueue::submit(Task task)
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_isClosed)
+        {
+            return false;
+        }
+
+        _tasks.push_back(std::move(task));
+
+        if (_maxConcurrency != 0 && _numActiveTasks >= _maxConcurrency)
+        {
+            // A running worker will pick up the task when it is done.
+            return true;
+        }
+
+        ++_numActiveTasks;
+    }
+
+    _threadPool.submit([this]() { _runNext(); });
+    return true;
+}
+
+
+void TaskQueue::close()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _isClosed = true;
+    _tasks.clear();
+    _condition.wait(lock, [this]() { return _numActiveTasks == 0; });
+}
+
+
+bool TaskQueue::isClosed() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _isClosed;
+}
+
+
+std::size_t TaskQueue::numQueuedTasks() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+
+std::size_t TaskQueue::numActiveTasks() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _numActiveTasks;
+}
+
+
+void TaskQueue::_runNext()
+{
+    Task task;
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_tasks.empty())
+        {
+            // The queue was closed before this worker started.
+            --_numActiveTasks;
+            _condition.notify_all();
+            return;
+        }
+
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+    }
+
+    task();
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_tasks.empty())
+        {
+            --_numActiveTasks;
+            _condition.notify_all();
+            return;
+        }
+    }
+
+    // Yield the worker to other queues before running the next task.
+    _threadPool.submit([this]() { _runNext(); });
+}
+
+
+} } // namespace ofx::JSONRPC
@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2014 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier:	MIT
+//
+
+
+#include "ofx/JSONRPC/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+
+namespace ofx {
+namespace JSONRPC {
+
+
+ThreadPool::ThreadPool(std::size_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < numThreads; ++i)
+    {
+        _threads.push_back(std::thread(&ThreadPool::_run, this));
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _isRunning = false;
+    }
+
+    _condition.notify_all();
+
+    for (auto& thread: _threads)
+    {
+        thread.join();
+    }
+}
+
+
+void ThreadPool::submit(Task task)
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+
+    _condition.notify_one();
+}
+
+
+void ThreadPool::parallelFor(std::size_t count,
+                             const std::function<void(std::size_t)>& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<std::size_t> next;
+        std::size_t remaining;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->next = 0;
+    state->remaining = count;
+
+    // Helpers may start after all indices have been claimed, in which case
+    // they return without touching the function.
+    auto work = [state, count, &function]()
+    {
+        std::size_t index = 0;
+
+        while ((index = state->next.fetch_add(1)) < count)
+        {
+            function(index);
+
+            std::unique_lock<std::mutex> lock(state->mutex);
+
+            if (--state->remaining == 0)
+            {
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    std::size_t numHelpers = std::min(count - 1, size());
+
+    for (std::size_t i = 0; i < numHelpers; ++i)
+    {
+        submit(work);
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [state]() { return state->remaining == 0; });
+}
+
+
+std::size_t ThreadPool::size() const
+{
+    return _threads.size();
+}
+
+
+std::size_t ThreadPool::numQueuedTasks() const
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+
+void ThreadPool::_run()
+{
+    while (true)
+    {
+        Task task;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            _condition.wait(lock, [this]() {
+                return !_isRunning || !_tasks.empty();
+            });
+
+            if (_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+
+} } // namespace ofx::JSONRPC
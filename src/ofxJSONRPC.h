@@ -11,12 +11,27 @@
 #include "json.hpp"
 #include "ofxHTTP.h"
 #include "ofx/JSONRPC/BaseMessage.h"
+#include "ofx/JSONRPC/CancellationToken.h"
+#include "ofx/JSONRPC/ConcurrencyLimiter.h"
+#include "ofx/JSONRPC/DeferredResult.h"
+#include "ofx/JSONRPC/DetachedServerEvent.h"
+#include "ofx/JSONRPC/Encoding.h"
 #include "ofx/JSONRPC/Error.h"
 #include "ofx/JSONRPC/Errors.h"
+#include "ofx/JSONRPC/LatencyHistogram.h"
+#include "ofx/JSONRPC/MainThreadQueue.h"
 #include "ofx/JSONRPC/MethodArgs.h"
 #include "ofx/JSONRPC/MethodRegistry.h"
+#include "ofx/JSONRPC/MethodStats.h"
 #include "ofx/JSONRPC/Request.h"
 #include "ofx/JSONRPC/Response.h"
+#include "ofx/JSONRPC/ResultCache.h"
+#include "ofx/JSONRPC/Scheduler.h"
+#include "ofx/JSONRPC/Task.h"
+#include "ofx/JSONRPC/TaskQueue.h"
+#include "ofx/JSONRPC/ThreadPool.h"
+#include "ofx/HTTP/JSONRPCWebSocketRoute.h"
+#include "ofx/HTTP/MetricsRoute.h"
 #include "ofx/HTTP/JSONRPCServer.h"
 
 namespace ofxJSONRPC = ofx::JSONRPC;